@@ -11,6 +11,8 @@ import core;
 import vector;
 import matrix;
 import trig;
+import dispatch;
+import bounds;
 
 constexpr auto screenWidth = 600.0f, halfScreenWidth = (screenWidth / 2.0f);
 constexpr auto screenHeight = 600.0f, halfScreenHeight = (screenHeight / 2.0f);
@@ -20,6 +22,12 @@ constexpr auto aspectRatio = (screenHeight / screenWidth);
 constexpr auto nearPlane = 0.1f;
 constexpr auto farPlane = 100.0f;
 
+//triangles that stay within this many half-viewports of the center are not clipped at the screen edges; the decal rasterizer scissors them
+constexpr auto guardBand = 2.0f;
+
+//triangles per culling chunk, in load order
+constexpr auto chunkSize = static_cast<std::size_t>(256);
+
 class Renderer : public olc::PixelGameEngine
 {
 public:
@@ -31,7 +39,18 @@ public:
 public:
 	cla::float4x4 matProj, matRot, matTrans;
 
-	std::vector<cla::tri<float>> meshLoaded, trisToRaster;
+	cla::mesh<float> meshLoaded;
+
+	std::vector<cla::tri<float>> trisToRaster, trisClip, trisClipped, trisInside;
+
+	//per-frame transformed copies of meshLoaded.vertices, in world and clip space
+	std::vector<cla::vf3d> vertsWorld, vertsClip;
+
+	std::vector<cla::aabb<float>> meshChunks;
+
+	//vertex range each chunk refers to, its classification this frame and the merged ranges left to transform
+	std::vector<std::pair<std::size_t, std::size_t>> meshChunkVerts, vertsVisible;
+	std::vector<cla::containment> chunkVisibility;
 
 	cla::vf3d cameraAcc, cameraVel, cameraPos, lookDir;
 
@@ -58,13 +77,30 @@ public:
 
 		gfxTexture.Load("./solid.png");
 
-		meshLoaded = cla::loadOBJ("./test.obj");
+		meshLoaded = cla::loadMesh("./test.obj");
+
+		//first-use order keeps each chunk's vertices together, so culled chunks skip their vertex transforms too
+		cla::reorder_vertices(meshLoaded);
 
-		for (auto& t : meshLoaded) t.texture = gfxTexture.Decal();
+		meshLoaded.texture = gfxTexture.Decal();
 
 
-		trisToRaster.reserve(meshLoaded.size());
-		trisToRaster.resize(meshLoaded.size());
+		trisToRaster.reserve(meshLoaded.triangles());
+		trisToRaster.resize(meshLoaded.triangles());
+
+		//written by index, never grown: copying a cla::tri resets w, which clip space still needs
+		trisClip.resize(meshLoaded.triangles());
+		trisInside.resize(meshLoaded.triangles());
+
+		//filled by cla::transform, which writes w as well
+		vertsWorld.resize(meshLoaded.vertices.size());
+		vertsClip.resize(meshLoaded.vertices.size());
+
+		meshChunks = cla::chunk_bounds(meshLoaded, chunkSize);
+		meshChunkVerts = cla::chunk_vertex_ranges(meshLoaded, chunkSize);
+
+		chunkVisibility.resize(meshChunks.size());
+		vertsVisible.reserve(meshChunks.size());
 
 		return true;
 	}
@@ -145,69 +181,114 @@ public:
 
 		cla::float4x4 matView = ~cla::pointAt(cameraPos, target, up);
 
-		for (auto& t : meshLoaded)
+		const cla::float4x4 matWorldViewProj = matWorld * matView * matProj;
+
+		//object-space frustum, so the chunk boxes computed at load time are tested as they are
+		const auto frustum = cla::frustum_planes(matWorldViewProj);
+
+		vertsVisible.clear();
+
+		for (std::size_t c = 0; c < meshChunks.size(); ++c)
 		{
-			cla::tri<float> triTransformed, triViewed, triProjected;
+			chunkVisibility[c] = cla::classify(frustum, meshChunks[c]);
 
-			triTransformed.p1 = t.p1 * matWorld;
-			triTransformed.p2 = t.p2 * matWorld;
-			triTransformed.p3 = t.p3 * matWorld;
+			if (chunkVisibility[c] != cla::containment::outside) vertsVisible.push_back(meshChunkVerts[c]);
+		}
 
-			cla::vf3d line1 = triTransformed.p2 - triTransformed.p1;
-			cla::vf3d line2 = triTransformed.p3 - triTransformed.p1;
+		//each vertex of a visible chunk is transformed once, overlapping ranges merged first;
+		//the triangles below only gather from these
+		std::sort(vertsVisible.begin(), vertsVisible.end());
 
-			cla::vf3d normal = cla::normalize(cla::cross(line1, line2));
+		auto transformRange = [&](std::size_t first, std::size_t last)
+		{
+			const auto in = std::span<const cla::vf3d>(meshLoaded.vertices).subspan(first, last - first);
 
-			cla::vf3d cameraRay = triTransformed.p1 - cameraPos;
+			cla::transform(in, std::span(vertsWorld).subspan(first, last - first), matWorld);
+			cla::transform(in, std::span(vertsClip).subspan(first, last - first), matWorldViewProj);
+		};
 
-			if (cla::dot(normal, cameraRay) < 0.0f)
-			{
-				cla::vf3d light_direction = cla::normalize({ 1.0f, 0.0f, 0.0f });
+		for (std::size_t r = 0; r < vertsVisible.size();)
+		{
+			auto [first, last] = vertsVisible[r++];
 
-				float dp = ((std::powf(50.0f, ((cla::dot(normal, light_direction) + 1.0f) * 0.5f)) - 1.0f) * 0.02f);
+			while (r < vertsVisible.size() && vertsVisible[r].first <= last) last = std::max(last, vertsVisible[r++].second);
 
-				triViewed.p1 = cla::mul(triTransformed.p1, matView);
-				triViewed.p2 = cla::mul(triTransformed.p2, matView);
-				triViewed.p3 = cla::mul(triTransformed.p3, matView);
+			transformRange(first, last);
+		}
 
-				triViewed.p1 = triTransformed.p1 * matView;
-				triViewed.p2 = triTransformed.p2 * matView;
-				triViewed.p3 = triTransformed.p3 * matView;
+		std::size_t clipCount = 0, insideCount = 0;
 
-				int clippedTris = 0;
-				cla::tri<float> clipped[2];
-				clippedTris = cla::clip({ 0.0f, 0.0f, 0.1f }, { 0.0f, 0.0f, 1.0f }, triViewed, clipped[0], clipped[1]);
+		for (std::size_t c = 0; c < meshChunks.size(); ++c)
+		{
+			//chunks fully outside skip all per-triangle work, chunks fully inside skip clipping
+			const auto visibility = chunkVisibility[c];
 
-				for (int n = 0; n < clippedTris; ++n)
-				{
-					triProjected.p1 = clipped[n].p1 * matProj;
-					triProjected.p2 = clipped[n].p2 * matProj;
-					triProjected.p3 = clipped[n].p3 * matProj;
+			if (visibility == cla::containment::outside) continue;
 
+			const auto first = c * chunkSize, last = std::min(first + chunkSize, meshLoaded.triangles());
 
-					triProjected.p1 = (triProjected.p1 / triProjected.p1.w);
-					triProjected.p2 = (triProjected.p2 / triProjected.p2.w);
-					triProjected.p3 = (triProjected.p3 / triProjected.p3.w);
+			for (auto i = first; i < last; ++i)
+			{
+				const auto i1 = meshLoaded.indices[i * 3 + 0], i2 = meshLoaded.indices[i * 3 + 1], i3 = meshLoaded.indices[i * 3 + 2];
+
+				cla::vf3d line1 = vertsWorld[i2] - vertsWorld[i1];
+				cla::vf3d line2 = vertsWorld[i3] - vertsWorld[i1];
 
+				cla::vf3d normal = cla::normalize<cla::accuracy::fast>(cla::cross(line1, line2));
 
-					triProjected.p1 = -triProjected.p1;
-					triProjected.p2 = -triProjected.p2;
-					triProjected.p3 = -triProjected.p3;
+				cla::vf3d cameraRay = vertsWorld[i1] - cameraPos;
 
+				if (cla::dot(normal, cameraRay) < 0.0f)
+				{
+					cla::vf3d light_direction = cla::normalize({ 1.0f, 0.0f, 0.0f });
 
-					triProjected.p1 = (triProjected.p1 + 1.0f);
-					triProjected.p2 = (triProjected.p2 + 1.0f);
-					triProjected.p3 = (triProjected.p3 + 1.0f);
+					float dp = ((std::powf(50.0f, ((cla::dot(normal, light_direction) + 1.0f) * 0.5f)) - 1.0f) * 0.02f);
 
+					auto& triClip = (visibility == cla::containment::inside) ? trisInside[insideCount++] : trisClip[clipCount++];
 
-					triProjected.p1.x *= halfScreenWidth;  triProjected.p2.x *= halfScreenWidth;  triProjected.p3.x *= halfScreenWidth;
-					triProjected.p1.y *= halfScreenHeight; triProjected.p2.y *= halfScreenHeight; triProjected.p3.y *= halfScreenHeight;
+					triClip.p1 = vertsClip[i1];
+					triClip.p2 = vertsClip[i2];
+					triClip.p3 = vertsClip[i3];
 
-					trisToRaster.emplace_back(cla::tri<float>(triProjected.p1, triProjected.p2, triProjected.p3, olc::PixelF(dp, dp, dp, 1.0f), t.texture) );
+					triClip.lightVal = olc::PixelF(dp, dp, dp, 1.0f);
+					triClip.texture = meshLoaded.texture;
 				}
 			}
 		}
 
+		//perspective divide and viewport mapping
+		auto project = [&](const cla::tri<float>& clipped)
+		{
+			cla::tri<float> triProjected;
+
+			triProjected.p1 = cla::apply<std::divides<>>(clipped.p1, clipped.p1.w);
+			triProjected.p2 = cla::apply<std::divides<>>(clipped.p2, clipped.p2.w);
+			triProjected.p3 = cla::apply<std::divides<>>(clipped.p3, clipped.p3.w);
+
+
+			triProjected.p1 = -triProjected.p1;
+			triProjected.p2 = -triProjected.p2;
+			triProjected.p3 = -triProjected.p3;
+
+
+			triProjected.p1 = (triProjected.p1 + 1.0f);
+			triProjected.p2 = (triProjected.p2 + 1.0f);
+			triProjected.p3 = (triProjected.p3 + 1.0f);
+
+
+			triProjected.p1.x *= halfScreenWidth;  triProjected.p2.x *= halfScreenWidth;  triProjected.p3.x *= halfScreenWidth;
+			triProjected.p1.y *= halfScreenHeight; triProjected.p2.y *= halfScreenHeight; triProjected.p3.y *= halfScreenHeight;
+
+			trisToRaster.emplace_back(cla::tri<float>(triProjected.p1, triProjected.p2, triProjected.p3, clipped.lightVal, clipped.texture));
+		};
+
+		//near plane and guard band in clip space, before the divide; most triangles pass through untouched
+		trisClipped.resize(clipCount * 6);
+
+		for (auto& clipped : cla::clip_homogeneous<float>(std::span(trisClip).first(clipCount), trisClipped, guardBand)) project(clipped);
+
+		for (auto& inside : std::span(trisInside).first(insideCount)) project(inside);
+
 		std::sort(trisToRaster.begin(), trisToRaster.end(), [](cla::tri<float>& t1, cla::tri<float>& t2)
 		{
 			float z1 = (t1.p1.z + t1.p2.z + t1.p3.z) * 0.3333333333f;
@@ -217,48 +298,15 @@ public:
 		});
 
 
-		for (auto& triToRaster : trisToRaster)
+		for (auto& t : trisToRaster)
 		{
-			cla::tri<float> clipped[2];
-			std::list<cla::tri<float>> listTriangles;
-
-			listTriangles.push_back(triToRaster);
-			std::size_t newTris = 1z;
-
-			for (int p = 0; p < 4; p++)
-			{
-				int addTris = 0;
-				while (newTris > 0)
-				{
-					cla::tri<float> test = listTriangles.front();
-					listTriangles.pop_front();
-					newTris--;
-
-					switch (p)
-					{
-						case 0: addTris = cla::clip(cla::vf3d(0.0f, 0.0f, 0.0f), cla::vf3d(0.0f, 1.0f, 0.0f), test, clipped[0], clipped[1]); break;
-						case 1: addTris = cla::clip(cla::vf3d(0.0f, screenHeight - 1.0f, 0.0f), cla::vf3d(0.0f, -1.0f, 0.0f), test, clipped[0], clipped[1]); break;
-						case 2: addTris = cla::clip(cla::vf3d(0.0f, 0.0f, 0.0f), cla::vf3d(1.0f, 0.0f, 0.0f), test, clipped[0], clipped[1]); break;
-						case 3: addTris = cla::clip(cla::vf3d(screenWidth - 1.0f, 0.0f, 0.0f), cla::vf3d(-1.0f, 0.0f, 0.0f), test, clipped[0], clipped[1]); break;
-					}
-
-					for (int w = 0; w < addTris; ++w)
-						listTriangles.emplace_back(cla::tri{ clipped[w].p1, clipped[w].p2, clipped[w].p3, triToRaster.lightVal, triToRaster.texture });
-				}
-
-				newTris = listTriangles.size();
-			}
-
-			for (auto& t : listTriangles)
+			DrawPolygonDecal(t.texture,
+			//std::array<olc::vf2d, 3>
 			{
-				DrawPolygonDecal(t.texture,
-				//std::array<olc::vf2d, 3>
-				{
-					olc::vf2d{ t.p1.x, t.p1.y },
-					olc::vf2d{ t.p2.x, t.p2.y },
-					olc::vf2d{ t.p3.x, t.p3.y }
-				}, t.lightVal);
-			}
+				olc::vf2d{ t.p1.x, t.p1.y },
+				olc::vf2d{ t.p2.x, t.p2.y },
+				olc::vf2d{ t.p3.x, t.p3.y }
+			}, t.lightVal);
 		}
 
 		trisToRaster.clear();
@@ -266,6 +314,7 @@ public:
 		DrawStringDecal({ 10.0f, 10.0f }, cameraPos.str(), olc::YELLOW);
 		DrawStringDecal({ 10.0f, 25.0f }, cameraVel.str(), olc::YELLOW);
 		DrawStringDecal({ 10.0f, 40.0f }, cameraAcc.str(), olc::YELLOW);
+		DrawStringDecal({ 10.0f, 70.0f }, cla::simd_name(cla::simd_active()), olc::YELLOW);
 
 		return !(GetKey(olc::Key::ESCAPE).bPressed);
 	}
@@ -0,0 +1,206 @@
+module;
+#include <algorithm>
+#include <array>
+#include <vector>
+#include <utility>
+export module batch;
+
+import core;
+import lanes;
+import matrix;
+
+export namespace cla
+{
+	//N square matrices in structure-of-arrays form: data[i][j] holds element (i, j) of every matrix, so one pack load
+	//reads the same element of lane_width<T> consecutive matrices; N a multiple of 8 keeps the float kernels tail-free
+	template<typename T = float, std::size_t S = 4, std::size_t N = 8>
+	struct matrix_batch
+	{
+		alignas(64) std::array<std::array<std::array<T, N>, S>, S> data;
+
+		static constexpr std::size_t size() noexcept { return N; }
+
+		constexpr auto get(std::size_t n) const noexcept
+		{
+			cla::matrix<T, S> mat;
+
+			for (std::size_t i = 0; i < S; ++i)
+			{
+				for (std::size_t j = 0; j < S; ++j) mat.data[i][j] = data[i][j][n];
+			}
+
+			return mat;
+		}
+
+		constexpr auto set(std::size_t n, const cla::matrix<T, S>& mat) noexcept
+		{
+			for (std::size_t i = 0; i < S; ++i)
+			{
+				for (std::size_t j = 0; j < S; ++j) data[i][j][n] = mat.data[i][j];
+			}
+		}
+	};
+
+	template<std::size_t N = 8>
+	using float3x3_batch = matrix_batch<float, 3, N>;
+
+	template<std::size_t N = 8>
+	using float4x4_batch = matrix_batch<float, 4, N>;
+
+	template<std::size_t N = 8>
+	using double3x3_batch = matrix_batch<double, 3, N>;
+
+	template<std::size_t N = 8>
+	using double4x4_batch = matrix_batch<double, 4, N>;
+
+	//calls kernel(pack, n) for every full pack of lanes in [0, count), then once per remaining lane with a plain T
+	template<typename T, typename Kernel>
+	inline auto batch_lanes(std::size_t count, Kernel&& kernel) noexcept
+	{
+		std::size_t n = 0;
+
+		if constexpr (cla::lane_width<T> > 1)
+		{
+			for (; n + cla::lane_width<T> <= count; n += cla::lane_width<T>) kernel(cla::lane_pack<T>{}, n);
+		}
+
+		for (; n < count; ++n) kernel(T{}, n);
+	}
+
+	//gathers mats[first, first + N); lanes past the end are left as identity so inverse stays finite
+	template<std::size_t N = 8, typename T = float, std::size_t S = 4>
+	constexpr auto to_batch(const std::vector<cla::matrix<T, S>>& mats, std::size_t first = 0) noexcept
+	{
+		cla::matrix_batch<T, S, N> batch{};
+
+		for (std::size_t n = 0; n < N; ++n)
+		{
+			for (std::size_t i = 0; i < S; ++i) batch.data[i][i][n] = (T)1.0f;
+		}
+
+		for (std::size_t n = 0; n < N && first + n < mats.size(); ++n) batch.set(n, mats[first + n]);
+
+		return batch;
+	}
+
+	template<typename T = float, std::size_t S = 4, std::size_t N = 8>
+	constexpr auto transpose(const cla::matrix_batch<T, S, N>& batch) noexcept
+	{
+		cla::matrix_batch<T, S, N> out;
+
+		for (std::size_t i = 0; i < S; ++i)
+		{
+			for (std::size_t j = 0; j < S; ++j) out.data[i][j] = batch.data[j][i];
+		}
+
+		return out;
+	}
+
+	//per-lane batch1[n] * batch2[n], same order as cla::compose
+	template<typename T = float, std::size_t S = 4, std::size_t N = 8>
+	inline auto compose(const cla::matrix_batch<T, S, N>& batch1, const cla::matrix_batch<T, S, N>& batch2) noexcept
+	{
+		cla::matrix_batch<T, S, N> out;
+
+		cla::batch_lanes<T>(N, [&](auto pack, std::size_t n)
+		{
+			using P = decltype(pack);
+
+			for (std::size_t i = 0; i < S; ++i)
+			{
+				P row[S];
+
+				for (std::size_t k = 0; k < S; ++k) row[k] = cla::lane_load<P>(&batch1.data[i][k][n]);
+
+				for (std::size_t j = 0; j < S; ++j)
+				{
+					P sum = row[0] * cla::lane_load<P>(&batch2.data[0][j][n]);
+
+					for (std::size_t k = 1; k < S; ++k) sum += row[k] * cla::lane_load<P>(&batch2.data[k][j][n]);
+
+					cla::lane_store(&out.data[i][j][n], sum);
+				}
+			}
+		});
+
+		return out;
+	}
+
+	//vertex n is transformed by matrix n, for min(verts.size(), N) vertices; 4 x 4 batches treat w as 1 like cla::mul,
+	//3 x 3 batches are purely linear (e.g. inertia tensor times angular velocity)
+	template<typename T = float, std::size_t S = 4, std::size_t N = 8>
+	auto mul(const cla::vertex_soa<T>& verts, const cla::matrix_batch<T, S, N>& batch) requires (S == 3 || S == 4)
+	{
+		const auto count = std::min(verts.size(), N);
+
+		cla::vertex_soa<T> out(count);
+
+		const T* const src[3] = { verts.x.data(), verts.y.data(), verts.z.data() };
+		T* const dst[4] = { out.x.data(), out.y.data(), out.z.data(), out.w.data() };
+
+		cla::batch_lanes<T>(count, [&](auto pack, std::size_t n)
+		{
+			using P = decltype(pack);
+
+			const P v[3] = { cla::lane_load<P>(src[0] + n), cla::lane_load<P>(src[1] + n), cla::lane_load<P>(src[2] + n) };
+
+			for (std::size_t j = 0; j < S; ++j)
+			{
+				P sum = v[0] * cla::lane_load<P>(&batch.data[0][j][n]) + v[1] * cla::lane_load<P>(&batch.data[1][j][n]) + v[2] * cla::lane_load<P>(&batch.data[2][j][n]);
+
+				if constexpr (S == 4) sum += cla::lane_load<P>(&batch.data[3][j][n]);
+
+				cla::lane_store(dst[j] + n, sum);
+			}
+		});
+
+		return out;
+	}
+
+	//general inverse of every matrix in the batch; returns { inverses, determinants } with the same inf/nan rule as inverse_general
+	template<typename T = float, std::size_t S = 4, std::size_t N = 8>
+	inline auto inverse_general(const cla::matrix_batch<T, S, N>& batch) noexcept requires (S == 3 || S == 4)
+	{
+		cla::matrix_batch<T, S, N> out;
+		std::array<T, N> dets;
+
+		cla::batch_lanes<T>(N, [&](auto pack, std::size_t n)
+		{
+			using P = decltype(pack);
+
+			P a[S][S], inv[S][S];
+
+			for (std::size_t i = 0; i < S; ++i)
+			{
+				for (std::size_t j = 0; j < S; ++j) a[i][j] = cla::lane_load<P>(&batch.data[i][j][n]);
+			}
+
+			P det;
+
+			if constexpr (S == 4) det = cla::inverse_cofactor4(a, inv);
+			else det = cla::inverse_cofactor3(a, inv);
+
+			for (std::size_t i = 0; i < S; ++i)
+			{
+				for (std::size_t j = 0; j < S; ++j) cla::lane_store(&out.data[i][j][n], inv[i][j]);
+			}
+
+			cla::lane_store(&dets[n], det);
+		});
+
+		return std::pair{ out, dets };
+	}
+
+	template<typename T = float, std::size_t S = 4, std::size_t N = 8>
+	inline auto operator*(const cla::matrix_batch<T, S, N>& batch1, const cla::matrix_batch<T, S, N>& batch2) noexcept
+	{
+		return cla::compose(batch1, batch2);
+	}
+
+	//inverse, as ~ is for a single matrix; determinants are dropped, call inverse_general to check for singular lanes
+	template<typename T = float, std::size_t S = 4, std::size_t N = 8>
+	inline auto operator~(const cla::matrix_batch<T, S, N>& batch) noexcept requires (S == 3 || S == 4)
+	{
+		return cla::inverse_general(batch).first;
+	}
+}
\ No newline at end of file
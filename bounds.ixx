@@ -0,0 +1,315 @@
+module;
+#include <algorithm>
+#include <functional>
+#include <array>
+#include <vector>
+#include <span>
+#include <limits>
+#include <cmath>
+#include <type_traits>
+#include <cstdint>
+#include <utility>
+#include <immintrin.h>
+export module bounds;
+
+import stdex;
+import core;
+import vector;
+import matrix;
+
+export namespace cla
+{
+	//axis-aligned box; an empty box has lower > upper on every axis
+	template<typename T = float>
+	struct aabb
+	{
+		cla::v3d_generic<T> lower, upper;
+
+		constexpr aabb() noexcept : lower(std::numeric_limits<T>::max(), std::numeric_limits<T>::max(), std::numeric_limits<T>::max()),
+			upper(std::numeric_limits<T>::lowest(), std::numeric_limits<T>::lowest(), std::numeric_limits<T>::lowest()) {}
+
+		constexpr aabb(const cla::v3d_generic<T>& lower, const cla::v3d_generic<T>& upper) noexcept : lower(lower), upper(upper) {}
+
+		constexpr auto empty() const noexcept { return lower.x > upper.x || lower.y > upper.y || lower.z > upper.z; }
+
+		constexpr auto center() const noexcept { return cla::apply<std::multiplies<>>(cla::reduce<std::plus<>>(lower, upper), (T)0.5f); }
+	};
+
+	template<typename T = float>
+	struct sphere
+	{
+		cla::v3d_generic<T> center;
+		T radius = (T)0.0f;
+	};
+
+	//six inward-facing planes: left, right, bottom, top, near, far
+	template<typename T = float>
+	using frustum = std::array<cla::plane<T>, 6>;
+
+	enum class containment { outside, intersecting, inside };
+
+	template<typename T = float>
+	constexpr auto merge(const cla::aabb<T>& box1, const cla::aabb<T>& box2) noexcept
+	{
+		return cla::aabb<T>(cla::v3d_generic<T>(std::min(box1.lower.x, box2.lower.x), std::min(box1.lower.y, box2.lower.y), std::min(box1.lower.z, box2.lower.z)),
+			cla::v3d_generic<T>(std::max(box1.upper.x, box2.upper.x), std::max(box1.upper.y, box2.upper.y), std::max(box1.upper.z, box2.upper.z)));
+	}
+
+	//min/max reduction over the points; float keeps four running min and max registers of whole (x, y, z, w) vertices
+	template<typename T = float>
+	auto bounds(std::span<const cla::v3d_generic<std::type_identity_t<T>>> points) noexcept
+	{
+		cla::aabb<T> box;
+
+		std::size_t i = 0;
+
+		if constexpr (std::is_same_v<T, float>)
+		{
+			__m128 lo[4], hi[4];
+
+			for (auto k = 0; k < 4; ++k) lo[k] = _mm_set1_ps(std::numeric_limits<float>::max()), hi[k] = _mm_set1_ps(std::numeric_limits<float>::lowest());
+
+			for (; i + 4 <= points.size(); i += 4)
+			{
+				for (auto k = 0; k < 4; ++k)
+				{
+					const __m128 p = _mm_loadu_ps(&points[i + k].x);
+
+					lo[k] = _mm_min_ps(lo[k], p); hi[k] = _mm_max_ps(hi[k], p);
+				}
+			}
+
+			alignas(16) float l[4], h[4];
+			_mm_store_ps(l, _mm_min_ps(_mm_min_ps(lo[0], lo[1]), _mm_min_ps(lo[2], lo[3])));
+			_mm_store_ps(h, _mm_max_ps(_mm_max_ps(hi[0], hi[1]), _mm_max_ps(hi[2], hi[3])));
+
+			box = cla::aabb<float>(cla::v3d_generic<float>(l[0], l[1], l[2]), cla::v3d_generic<float>(h[0], h[1], h[2]));
+		}
+
+		for (; i < points.size(); ++i) box = cla::merge(box, cla::aabb<T>(points[i], points[i]));
+
+		return box;
+	}
+
+	template<typename T = float>
+	auto bounds(std::span<const cla::tri<std::type_identity_t<T>>> tris) noexcept
+	{
+		cla::aabb<T> box;
+
+		if constexpr (std::is_same_v<T, float>)
+		{
+			__m128 lo = _mm_set1_ps(std::numeric_limits<float>::max()), hi = _mm_set1_ps(std::numeric_limits<float>::lowest());
+
+			for (const auto& t : tris)
+			{
+				const __m128 p1 = _mm_loadu_ps(&t.p1.x), p2 = _mm_loadu_ps(&t.p2.x), p3 = _mm_loadu_ps(&t.p3.x);
+
+				lo = _mm_min_ps(lo, _mm_min_ps(p1, _mm_min_ps(p2, p3)));
+				hi = _mm_max_ps(hi, _mm_max_ps(p1, _mm_max_ps(p2, p3)));
+			}
+
+			alignas(16) float l[4], h[4];
+			_mm_store_ps(l, lo); _mm_store_ps(h, hi);
+
+			box = cla::aabb<float>(cla::v3d_generic<float>(l[0], l[1], l[2]), cla::v3d_generic<float>(h[0], h[1], h[2]));
+		}
+		else
+		{
+			for (const auto& t : tris) box = cla::merge(box, cla::merge(cla::aabb<T>(t.p1, t.p1), cla::merge(cla::aabb<T>(t.p2, t.p2), cla::aabb<T>(t.p3, t.p3))));
+		}
+
+		return box;
+	}
+
+	//one box per run of chunkSize triangles (the last may be shorter), so a mesh stored chunk by chunk can be culled in pieces
+	template<typename T = float>
+	auto chunk_bounds(std::span<const cla::tri<std::type_identity_t<T>>> tris, std::size_t chunkSize)
+	{
+		std::vector<cla::aabb<T>> boxes;
+
+		chunkSize = std::max(chunkSize, static_cast<std::size_t>(1));
+		boxes.reserve((tris.size() + chunkSize - 1) / chunkSize);
+
+		for (std::size_t i = 0; i < tris.size(); i += chunkSize) boxes.push_back(cla::bounds<T>(tris.subspan(i, std::min(chunkSize, tris.size() - i))));
+
+		return boxes;
+	}
+
+	//same for an indexed mesh, chunking its index buffer by triangle; vertices are gathered through the indices
+	template<typename T = float, typename Index = std::uint32_t>
+	auto chunk_bounds(const cla::mesh<T, Index>& mesh, std::size_t chunkSize)
+	{
+		std::vector<cla::aabb<T>> boxes;
+
+		chunkSize = std::max(chunkSize, static_cast<std::size_t>(1));
+
+		const auto tris = mesh.triangles();
+		boxes.reserve((tris + chunkSize - 1) / chunkSize);
+
+		for (std::size_t c = 0; c < tris; c += chunkSize)
+		{
+			const auto first = c * 3, last = std::min(c + chunkSize, tris) * 3;
+
+			cla::aabb<T> box;
+
+			if constexpr (std::is_same_v<T, float>)
+			{
+				__m128 lo = _mm_set1_ps(std::numeric_limits<float>::max()), hi = _mm_set1_ps(std::numeric_limits<float>::lowest());
+
+				for (auto i = first; i < last; ++i)
+				{
+					const __m128 p = _mm_loadu_ps(&mesh.vertices[mesh.indices[i]].x);
+
+					lo = _mm_min_ps(lo, p); hi = _mm_max_ps(hi, p);
+				}
+
+				alignas(16) float l[4], h[4];
+				_mm_store_ps(l, lo); _mm_store_ps(h, hi);
+
+				box = cla::aabb<float>(cla::v3d_generic<float>(l[0], l[1], l[2]), cla::v3d_generic<float>(h[0], h[1], h[2]));
+			}
+			else
+			{
+				for (auto i = first; i < last; ++i) box = cla::merge(box, cla::aabb<T>(mesh.vertices[mesh.indices[i]], mesh.vertices[mesh.indices[i]]));
+			}
+
+			boxes.push_back(box);
+		}
+
+		return boxes;
+	}
+
+	//[first, last) of the vertex buffer referenced by each chunk of chunkSize triangles, matching cla::chunk_bounds;
+	//after cla::reorder_vertices these are narrow, so only the vertices of chunks that survive culling need transforming
+	template<typename T = float, typename Index = std::uint32_t>
+	auto chunk_vertex_ranges(const cla::mesh<T, Index>& mesh, std::size_t chunkSize)
+	{
+		std::vector<std::pair<std::size_t, std::size_t>> ranges;
+
+		chunkSize = std::max(chunkSize, static_cast<std::size_t>(1));
+
+		const auto tris = mesh.triangles();
+		ranges.reserve((tris + chunkSize - 1) / chunkSize);
+
+		for (std::size_t c = 0; c < tris; c += chunkSize)
+		{
+			const auto first = mesh.indices.begin() + c * 3, last = mesh.indices.begin() + std::min(c + chunkSize, tris) * 3;
+			const auto [lo, hi] = std::minmax_element(first, last);
+
+			ranges.emplace_back(static_cast<std::size_t>(*lo), static_cast<std::size_t>(*hi) + 1);
+		}
+
+		return ranges;
+	}
+
+	//centered on the box, radius from a max reduction of squared distances; float measures four points per register after a transpose
+	template<typename T = float>
+	auto bounding_sphere(std::span<const cla::v3d_generic<std::type_identity_t<T>>> points) noexcept
+	{
+		const auto box = cla::bounds<T>(points);
+
+		cla::sphere<T> s;
+		s.center = box.center();
+
+		T r2 = (T)0.0f;
+
+		std::size_t i = 0;
+
+		if constexpr (std::is_same_v<T, float>)
+		{
+			const __m128 cx = _mm_set1_ps(s.center.x), cy = _mm_set1_ps(s.center.y), cz = _mm_set1_ps(s.center.z);
+
+			__m128 best = _mm_setzero_ps();
+
+			for (; i + 4 <= points.size(); i += 4)
+			{
+				__m128 x = _mm_loadu_ps(&points[i + 0].x), y = _mm_loadu_ps(&points[i + 1].x), z = _mm_loadu_ps(&points[i + 2].x), w = _mm_loadu_ps(&points[i + 3].x);
+				_MM_TRANSPOSE4_PS(x, y, z, w);
+
+				x = _mm_sub_ps(x, cx); y = _mm_sub_ps(y, cy); z = _mm_sub_ps(z, cz);
+
+				best = _mm_max_ps(best, _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+			}
+
+			alignas(16) float b[4];
+			_mm_store_ps(b, best);
+
+			r2 = std::max(std::max(b[0], b[1]), std::max(b[2], b[3]));
+		}
+
+		for (; i < points.size(); ++i) r2 = std::max(r2, cla::length2(cla::reduce<std::minus<>>(points[i], s.center)));
+
+		s.radius = std::my_sqrt(r2);
+
+		return s;
+	}
+
+	//Gribb/Hartmann: with row vectors clip = p * mat, so clip.x is p against column 0 and the planes are column 3 +/- columns 0, 1,
+	//column 2 alone (z >= 0) for near and column 3 - column 2 for far. planes come out in the space mat maps from, so pass
+	//world * view * projection to cull object-space bounds
+	template<typename T = float>
+	constexpr auto frustum_planes(const cla::matrix<T, 4>& mat) noexcept
+	{
+		//plane column a + sign * column b, scaled to a unit normal
+		const auto make = [&](int a, int b, const T& sign)
+		{
+			const auto element = [&](int i) { return mat.data[i][a] + sign * mat.data[i][b]; };
+
+			const cla::v3d_generic<T> n(element(0), element(1), element(2));
+			const T scale = (T)1.0f / cla::length(n);
+
+			cla::plane<T> pl;
+			pl.n = cla::apply<std::multiplies<>>(n, scale);
+			pl.d = -element(3) * scale;
+
+			return pl;
+		};
+
+		cla::frustum<T> planes;
+
+		planes[0] = make(3, 0, (T)1.0f);
+		planes[1] = make(3, 0, (T)-1.0f);
+		planes[2] = make(3, 1, (T)1.0f);
+		planes[3] = make(3, 1, (T)-1.0f);
+		planes[4] = make(2, 2, (T)0.0f);
+		planes[5] = make(3, 2, (T)-1.0f);
+
+		return planes;
+	}
+
+	//per plane, the box corner furthest along the normal decides outside and the corner furthest against it decides inside
+	template<typename T = float>
+	constexpr auto classify(const cla::frustum<T>& planes, const cla::aabb<T>& box) noexcept
+	{
+		auto result = cla::containment::inside;
+
+		for (const auto& pl : planes)
+		{
+			const cla::v3d_generic<T> outer((pl.n.x >= 0) ? box.upper.x : box.lower.x, (pl.n.y >= 0) ? box.upper.y : box.lower.y, (pl.n.z >= 0) ? box.upper.z : box.lower.z);
+			const cla::v3d_generic<T> inner((pl.n.x >= 0) ? box.lower.x : box.upper.x, (pl.n.y >= 0) ? box.lower.y : box.upper.y, (pl.n.z >= 0) ? box.lower.z : box.upper.z);
+
+			if (cla::distance(pl, outer) < 0) return cla::containment::outside;
+
+			if (cla::distance(pl, inner) < 0) result = cla::containment::intersecting;
+		}
+
+		return result;
+	}
+
+	template<typename T = float>
+	constexpr auto classify(const cla::frustum<T>& planes, const cla::sphere<T>& s) noexcept
+	{
+		auto result = cla::containment::inside;
+
+		for (const auto& pl : planes)
+		{
+			const T d = cla::distance(pl, s.center);
+
+			if (d < -s.radius) return cla::containment::outside;
+
+			if (d < s.radius) result = cla::containment::intersecting;
+		}
+
+		return result;
+	}
+}
\ No newline at end of file
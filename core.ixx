@@ -6,21 +6,55 @@ module;
 #include <vector>
 #include <sstream>
 #include <fstream>
+#include <new>
+#include <thread>
+#include <cstddef>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <charconv>
+#include <atomic>
+#include <bit>
+#include <span>
+#include <utility>
+#include <immintrin.h>
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 #include "engine.hpp"
 export module core;
 
 export namespace cla
 {
-	template<typename T = float, std::size_t S = 4>
+	//row-major R x C storage; C defaults to R so matrix<T, S> remains the square matrix
+	template<typename T = float, std::size_t R = 4, std::size_t C = R>
 	class matrix
 	{
 	public:
-		std::array<std::array<T, S>, S> data;
+		std::array<std::array<T, C>, R> data;
 
-		template<typename T = float, std::size_t S>
-		constexpr auto operator*=(const cla::matrix<T, S>& mat) noexcept
+		constexpr auto operator*=(const cla::matrix<T, C, C>& mat) noexcept
 		{
-			data = data * mat;
+			*this = *this * mat;
+
+			return *this;
+		}
+	};
+
+	//affine transform in the row-vector convention of matrix<T, 4>: rows 0-2 hold the linear part, row 3 the translation
+	//the fourth column is implicitly (0, 0, 0, 1) and not stored
+	template<typename T = float>
+	class affine3x4
+	{
+	public:
+		std::array<std::array<T, 3>, 4> data;
+
+		constexpr auto operator*=(const cla::affine3x4<T>& aff) noexcept
+		{
+			*this = *this * aff;
 
 			return *this;
 		}
@@ -70,6 +104,166 @@ export namespace cla
 	using vf3d = v3d_generic<float>;
 	using vd3d = v3d_generic<double>;
 	
+	template<typename T, std::size_t Align = 64>
+	struct aligned_allocator
+	{
+		using value_type = T;
+
+		template<typename U>
+		struct rebind { using other = cla::aligned_allocator<U, Align>; };
+
+		constexpr aligned_allocator() noexcept = default;
+
+		template<typename U>
+		constexpr aligned_allocator(const cla::aligned_allocator<U, Align>&) noexcept {}
+
+		T* allocate(std::size_t n) { return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t{ Align })); }
+		void deallocate(T* p, std::size_t) noexcept { ::operator delete(p, std::align_val_t{ Align }); }
+
+		template<typename U>
+		bool operator == (const cla::aligned_allocator<U, Align>&) const noexcept { return true; }
+	};
+
+	template<typename T>
+	using aligned_vector = std::vector<T, cla::aligned_allocator<T>>;
+
+	//bump allocator over one aligned block; individual deallocations are no-ops and reset() reclaims everything at once
+	class arena
+	{
+	public:
+		explicit arena(std::size_t bytes) : buffer(static_cast<std::byte*>(::operator new(bytes, std::align_val_t{ 64 }))), capacity(bytes) {}
+		~arena() { ::operator delete(buffer, std::align_val_t{ 64 }); }
+
+		arena(const arena&) = delete;
+		arena& operator=(const arena&) = delete;
+
+		void* allocate(std::size_t bytes, std::size_t align = 64)
+		{
+			const auto offset = ((used + align - 1) / align) * align;
+
+			if (offset + bytes > capacity) throw std::bad_alloc{};
+
+			used = offset + bytes;
+
+			return buffer + offset;
+		}
+
+		void reset() noexcept { used = 0; }
+		std::size_t size() const noexcept { return used; }
+
+	private:
+		std::byte* buffer;
+		std::size_t capacity;
+		std::size_t used = 0;
+	};
+
+	template<typename T>
+	struct arena_allocator
+	{
+		using value_type = T;
+
+		cla::arena* source;
+
+		arena_allocator(cla::arena& a) noexcept : source(&a) {}
+
+		template<typename U>
+		arena_allocator(const cla::arena_allocator<U>& other) noexcept : source(other.source) {}
+
+		T* allocate(std::size_t n) { return static_cast<T*>(source->allocate(n * sizeof(T), std::max(alignof(T), static_cast<std::size_t>(64)))); }
+		void deallocate(T*, std::size_t) noexcept {}
+
+		template<typename U>
+		bool operator == (const cla::arena_allocator<U>& other) const noexcept { return source == other.source; }
+	};
+
+	//splits [0, count) into contiguous ranges of at least grain items, one per hardware thread, and calls fn(begin, end) on each
+	template<typename F>
+	auto parallel_for(std::size_t count, std::size_t grain, F&& fn)
+	{
+		const auto threads = std::min(static_cast<std::size_t>(std::max(std::thread::hardware_concurrency(), 1u)), count / std::max(grain, static_cast<std::size_t>(1)));
+
+		if (threads <= 1)
+		{
+			if (count > 0) fn(static_cast<std::size_t>(0), count);
+
+			return;
+		}
+
+		std::vector<std::thread> workers;
+		workers.reserve(threads);
+
+		const auto chunk = (count + threads - 1) / threads;
+
+		for (std::size_t begin = 0; begin < count; begin += chunk)
+		{
+			workers.emplace_back([&fn, begin, end = std::min(begin + chunk, count)]() { fn(begin, end); });
+		}
+
+		for (auto& worker : workers) worker.join();
+	}
+
+	//structure-of-arrays vertex storage; arrays are padded to a whole number of lanes so kernels never need a tail
+	template<typename T = float>
+	struct vertex_soa
+	{
+		static constexpr std::size_t lanes = 16;
+
+		cla::aligned_vector<T> x, y, z, w;
+
+		std::size_t count = 0;
+
+		vertex_soa() = default;
+
+		explicit vertex_soa(std::size_t n) : x(padded(n), (T)0.0f), y(padded(n), (T)0.0f), z(padded(n), (T)0.0f), w(padded(n), (T)1.0f), count(n) {}
+
+		static constexpr std::size_t padded(std::size_t n) noexcept { return ((n + lanes - 1) / lanes) * lanes; }
+
+		std::size_t size() const noexcept { return count; }
+		std::size_t blocks() const noexcept { return x.size() / lanes; }
+
+		void resize(std::size_t n)
+		{
+			x.resize(padded(n), (T)0.0f); y.resize(padded(n), (T)0.0f); z.resize(padded(n), (T)0.0f); w.resize(padded(n), (T)1.0f);
+			count = n;
+		}
+
+		cla::v3d_generic<T> get(std::size_t i) const noexcept
+		{
+			cla::v3d_generic<T> vec(x[i], y[i], z[i]);
+			vec.w = w[i];
+
+			return vec;
+		}
+
+		void set(std::size_t i, const cla::v3d_generic<T>& vec) noexcept { x[i] = vec.x; y[i] = vec.y; z[i] = vec.z; w[i] = vec.w; }
+	};
+
+	template<typename T = float>
+	auto to_soa(const std::vector<cla::v3d_generic<T>>& verts)
+	{
+		cla::vertex_soa<T> soa(verts.size());
+
+		for (std::size_t i = 0; i < verts.size(); ++i)
+		{
+			soa.set(i, verts[i]);
+		}
+
+		return soa;
+	}
+
+	template<typename T = float>
+	auto to_aos(const cla::vertex_soa<T>& soa)
+	{
+		std::vector<cla::v3d_generic<T>> verts(soa.size());
+
+		for (std::size_t i = 0; i < soa.size(); ++i)
+		{
+			verts[i] = soa.get(i);
+		}
+
+		return verts;
+	}
+	
 	//define primitive type aliases
 	template<typename T = float>
 	struct tri
@@ -86,39 +280,401 @@ export namespace cla
 			: p1(t1), p2(t2), p3(t3), lightVal(lightVal), texture(texture) {}
 	};
 
-	std::vector<cla::tri<float>> loadOBJ(const std::string& filename)
+	//shared vertex buffer plus three indices per triangle, so each vertex is stored and transformed once; Index is std::uint32_t or std::uint16_t
+	template<typename T = float, typename Index = std::uint32_t>
+	struct mesh
+	{
+		std::vector<cla::v3d_generic<T>> vertices;
+		std::vector<Index> indices;
+
+		olc::Decal* texture = nullptr;
+
+		std::size_t triangles() const noexcept { return indices.size() / 3; }
+	};
+
+	//renumbers vertices in order of first use by the index buffer, unused ones last, so each run of consecutive triangles
+	//refers to a narrow range of the vertex buffer and can be transformed on its own
+	template<typename T = float, typename Index = std::uint32_t>
+	auto reorder_vertices(cla::mesh<T, Index>& mesh)
+	{
+		constexpr auto unset = std::numeric_limits<std::size_t>::max();
+
+		std::vector<std::size_t> remap(mesh.vertices.size(), unset);
+
+		std::vector<cla::v3d_generic<T>> vertices;
+		vertices.reserve(mesh.vertices.size());
+
+		for (auto& i : mesh.indices)
+		{
+			if (remap[i] == unset)
+			{
+				remap[i] = vertices.size();
+				vertices.push_back(mesh.vertices[i]);
+			}
+
+			i = static_cast<Index>(remap[i]);
+		}
+
+		for (std::size_t v = 0; v < mesh.vertices.size(); ++v)
+		{
+			if (remap[v] == unset) vertices.push_back(mesh.vertices[v]);
+		}
+
+		mesh.vertices = std::move(vertices);
+	}
+
+	//read-only view of a whole file mapped into memory; empty if the file cannot be opened or mapped
+	class mapped_file
+	{
+	public:
+		explicit mapped_file(const std::string& filename)
+		{
+#if defined(_WIN32)
+			file = ::CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+			if (file == INVALID_HANDLE_VALUE) return;
+
+			LARGE_INTEGER bytes;
+			if (!::GetFileSizeEx(file, &bytes) || bytes.QuadPart == 0) return;
+
+			mapping = ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (mapping == nullptr) return;
+
+			view = static_cast<const char*>(::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+			if (view != nullptr) length = static_cast<std::size_t>(bytes.QuadPart);
+#else
+			file = ::open(filename.c_str(), O_RDONLY);
+			if (file < 0) return;
+
+			struct stat info;
+			if (::fstat(file, &info) != 0 || info.st_size == 0) return;
+
+			void* address = ::mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+			if (address == MAP_FAILED) return;
+
+			::madvise(address, static_cast<std::size_t>(info.st_size), MADV_SEQUENTIAL);
+
+			view = static_cast<const char*>(address);
+			length = static_cast<std::size_t>(info.st_size);
+#endif
+		}
+
+		~mapped_file()
+		{
+#if defined(_WIN32)
+			if (view != nullptr) ::UnmapViewOfFile(view);
+			if (mapping != nullptr) ::CloseHandle(mapping);
+			if (file != INVALID_HANDLE_VALUE) ::CloseHandle(file);
+#else
+			if (view != nullptr) ::munmap(const_cast<char*>(view), length);
+			if (file >= 0) ::close(file);
+#endif
+		}
+
+		mapped_file(const mapped_file&) = delete;
+		mapped_file& operator=(const mapped_file&) = delete;
+
+		const char* data() const noexcept { return view; }
+		std::size_t size() const noexcept { return length; }
+
+	private:
+#if defined(_WIN32)
+		HANDLE file = INVALID_HANDLE_VALUE, mapping = nullptr;
+#else
+		int file = -1;
+#endif
+		const char* view = nullptr;
+		std::size_t length = 0;
+	};
+
+	//first '\n' in [p, end), or end; sixteen bytes per compare
+	inline const char* find_newline(const char* p, const char* end) noexcept
+	{
+		const __m128i newline = _mm_set1_epi8('\n');
+
+		for (; p + 16 <= end; p += 16)
+		{
+			const int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), newline));
+
+			if (mask != 0) return p + std::countr_zero(static_cast<unsigned>(mask));
+		}
+
+		for (; p < end; ++p)
+		{
+			if (*p == '\n') return p;
+		}
+
+		return end;
+	}
+
+	//smallest share of the file, in bytes, worth parsing on its own thread
+	constexpr auto obj_grain = static_cast<std::size_t>(1 << 20);
+
+	//vertices and faces found in one newline-aligned slice of an OBJ file. an absolute index is stored as is (>= 0); a relative one
+	//becomes obj_relative + the slice-local vertex it names, which is negative when it reaches back into an earlier slice, and is
+	//rebased by the slice's first vertex once the slices are stitched
+	constexpr auto obj_relative = std::numeric_limits<std::int64_t>::min() / 2;
+
+	//relative references further back than this are rejected, which keeps obj_relative + local from overflowing
+	constexpr auto obj_relative_reach = static_cast<std::int64_t>(1) << 48;
+
+	struct obj_slice
+	{
+		std::vector<cla::vf3d> vertices;
+		std::vector<std::int64_t> indices;
+	};
+
+	//walks the v and f records of [p, end): vertex(x, y, z) for each position and face(a, b, c) for each triangle, polygons fanned,
+	//with the raw OBJ indices (1-based, or negative relative to the vertices read so far); corners may be v, v/vt, v//vn or v/vt/vn
+	template<typename V, typename F>
+	auto scan_obj(const char* p, const char* end, V&& vertex, F&& face)
 	{
-		std::ifstream f(filename);
-		if (!f.is_open()) return {};
+		const auto blank = [](char c) { return c == ' ' || c == '\t' || c == '\r'; };
+
+		const auto real = [&](const char*& q, const char* last)
+		{
+			float value = 0.0f;
+
+			while (q < last && blank(*q)) ++q;
+			if (q < last && *q == '+') ++q;
+
+			q = std::from_chars(q, last, value).ptr;
 
-		std::vector<cla::tri<float>> tris;
-		std::vector<cla::vf3d> verts;
+			return value;
+		};
 
-		while (!f.eof())
+		while (p < end)
 		{
-			char line[128];
-			f.getline(line, 128);
+			const char* const last = cla::find_newline(p, end);
 
-			std::stringstream s;
-			s << line;
+			while (p < last && blank(*p)) ++p;
 
-			char junk;
+			if (last - p > 1 && p[0] == 'v' && blank(p[1]))
+			{
+				const char* q = p + 1;
+
+				const float x = real(q, last), y = real(q, last), z = real(q, last);
+
+				vertex(x, y, z);
+			}
 
-			if (line[0] == 'v')
+			else if (last - p > 1 && p[0] == 'f' && blank(p[1]))
 			{
-				cla::vf3d v;
-				s >> junk >> v.x >> v.y >> v.z;
-				verts.push_back(v);
+				const char* q = p + 1;
+
+				std::int64_t corners[3];
+				std::size_t n = 0;
+
+				while (true)
+				{
+					while (q < last && blank(*q)) ++q;
+					if (q >= last) break;
+
+					std::int64_t index = 0;
+					const auto [next, error] = std::from_chars(q, last, index);
+
+					if (error != std::errc{}) break;
+
+					q = next;
+					while (q < last && !blank(*q)) ++q;
+
+					if (n < 3)
+					{
+						corners[n++] = index;
+
+						if (n == 3) face(corners[0], corners[1], corners[2]);
+					}
+					else
+					{
+						face(corners[0], corners[2], index);
+						corners[2] = index;
+					}
+				}
 			}
 
-			if (line[0] == 'f')
+			p = (last < end) ? last + 1 : end;
+		}
+	}
+
+	inline auto parse_obj(const char* p, const char* end)
+	{
+		cla::obj_slice slice;
+
+		slice.vertices.reserve(static_cast<std::size_t>(end - p) / 64);
+		slice.indices.reserve(static_cast<std::size_t>(end - p) / 16);
+
+		//1-based absolute, or relative to the vertices seen so far in this slice; 0 and unreachable relatives are left out of range
+		const auto encode = [&](std::int64_t index)
+		{
+			if (index > 0) return index - 1;
+			if (index < 0 && index >= -cla::obj_relative_reach) return cla::obj_relative + static_cast<std::int64_t>(slice.vertices.size()) + index;
+
+			return std::numeric_limits<std::int64_t>::max();
+		};
+
+		cla::scan_obj(p, end,
+			[&](float x, float y, float z) { slice.vertices.emplace_back(x, y, z); },
+			[&](std::int64_t a, std::int64_t b, std::int64_t c) { slice.indices.insert(slice.indices.end(), { encode(a), encode(b), encode(c) }); });
+
+		return slice;
+	}
+
+	//mmaps the file, splits it at newlines into slices, parses the slices in parallel with std::from_chars and stitches the
+	//vertex and index tables. reads v and f records (polygons are fanned, only the position index of each corner is used); returns
+	//an empty mesh if the file cannot be read, an index is out of range, or there are more vertices than Index can address.
+	//slices = 0 takes one per obj_grain bytes, up to one per thread; any other count is used as given, and 1 is the serial path
+	template<typename Index = std::uint32_t>
+	auto loadMesh(const std::string& filename, std::size_t slices = 0)
+	{
+		cla::mesh<float, Index> mesh;
+
+		const cla::mapped_file file(filename);
+		if (file.data() == nullptr) return mesh;
+
+		const char* const begin = file.data();
+		const char* const end = begin + file.size();
+
+		if (slices == 0) slices = std::clamp(file.size() / cla::obj_grain, static_cast<std::size_t>(1), static_cast<std::size_t>(std::max(std::thread::hardware_concurrency(), 1u)));
+
+		std::vector<const char*> cuts(slices + 1, end);
+		cuts[0] = begin;
+
+		for (std::size_t k = 1; k < slices; ++k)
+		{
+			const char* const cut = cla::find_newline(std::max(begin + file.size() / slices * k, cuts[k - 1]), end);
+			cuts[k] = (cut < end) ? cut + 1 : end;
+		}
+
+		std::vector<cla::obj_slice> parsed(slices);
+
+		cla::parallel_for(slices, 1, [&](std::size_t first, std::size_t last)
+		{
+			for (auto k = first; k < last; ++k) parsed[k] = cla::parse_obj(cuts[k], cuts[k + 1]);
+		});
+
+		std::vector<std::size_t> vertexBase(slices + 1, 0), indexBase(slices + 1, 0);
+
+		for (std::size_t k = 0; k < slices; ++k)
+		{
+			vertexBase[k + 1] = vertexBase[k] + parsed[k].vertices.size();
+			indexBase[k + 1] = indexBase[k] + parsed[k].indices.size();
+		}
+
+		const auto vertexCount = vertexBase[slices];
+
+		if (vertexCount > static_cast<std::size_t>(std::numeric_limits<Index>::max()) + 1) return mesh;
+
+		mesh.vertices.resize(vertexCount);
+		mesh.indices.resize(indexBase[slices]);
+
+		std::atomic<bool> valid = true;
+
+		cla::parallel_for(slices, 1, [&](std::size_t first, std::size_t last)
+		{
+			for (auto k = first; k < last; ++k)
 			{
-				int f[3];
-				s >> junk >> f[0] >> f[1] >> f[2];
-				tris.emplace_back(cla::tri<float>(verts[f[0] - 1], verts[f[1] - 1], verts[f[2] - 1], olc::WHITE, nullptr));
+				std::copy(parsed[k].vertices.begin(), parsed[k].vertices.end(), mesh.vertices.begin() + vertexBase[k]);
+
+				for (std::size_t i = 0; i < parsed[k].indices.size(); ++i)
+				{
+					const auto raw = parsed[k].indices[i];
+					const auto index = (raw >= 0) ? raw : static_cast<std::int64_t>(vertexBase[k]) + (raw - cla::obj_relative);
+
+					if (index < 0 || static_cast<std::size_t>(index) >= vertexCount) valid = false;
+
+					mesh.indices[indexBase[k] + i] = static_cast<Index>(index);
+				}
 			}
+		});
+
+		if (!valid) return cla::mesh<float, Index>{};
+
+		return mesh;
+	}
+
+	//streams an OBJ file of any size: positions go to onVertices and triangles to onFaces (three 0-based Index values each,
+	//polygons fanned) in blocks of at most blockSize items, through two buffers that are reused, so memory stays at
+	//O(blockSize) plus whatever pages of the mapping the OS keeps resident. blocks arrive in file order and spans are only
+	//valid during the call; every vertex a face block refers to has been delivered before that block, and a vertex block is cut
+	//short only when that requires it. faces with a zero index or one naming a vertex not yet read (a forward or out-of-range
+	//reference) are skipped. returns { vertices, faces } delivered, { 0, 0 } if the file cannot be read
+	template<typename Index = std::uint32_t, typename V, typename F>
+	auto streamOBJ(const std::string& filename, std::size_t blockSize, V&& onVertices, F&& onFaces)
+	{
+		const cla::mapped_file file(filename);
+		if (file.data() == nullptr) return std::pair{ static_cast<std::size_t>(0), static_cast<std::size_t>(0) };
+
+		blockSize = std::max(blockSize, static_cast<std::size_t>(1));
+
+		std::vector<cla::vf3d> vertices;
+		std::vector<Index> indices;
+		vertices.reserve(blockSize);
+		indices.reserve(blockSize * 3);
+
+		//delivered counts the vertices already handed out, needed is one past the highest vertex the pending faces refer to
+		std::size_t vertexCount = 0, faceCount = 0, delivered = 0, needed = 0;
+
+		const auto flushVertices = [&]() { if (!vertices.empty()) onVertices(std::span<const cla::vf3d>(vertices)); delivered += vertices.size(); vertices.clear(); };
+
+		const auto flushFaces = [&]()
+		{
+			if (needed > delivered) flushVertices();
+
+			if (!indices.empty()) onFaces(std::span<const Index>(indices));
+			indices.clear();
+		};
+
+		cla::scan_obj(file.data(), file.data() + file.size(),
+			[&](float x, float y, float z)
+			{
+				vertices.emplace_back(x, y, z);
+				++vertexCount;
+
+				if (vertices.size() == blockSize) flushVertices();
+			},
+			[&](std::int64_t a, std::int64_t b, std::int64_t c)
+			{
+				const auto resolve = [&](std::int64_t index) { return (index > 0) ? index - 1 : (index < 0) ? static_cast<std::int64_t>(vertexCount) + index : -1; };
+
+				const std::int64_t corners[3] = { resolve(a), resolve(b), resolve(c) };
+
+				for (const auto k : corners)
+				{
+					if (k < 0 || static_cast<std::uint64_t>(k) >= vertexCount || static_cast<std::uint64_t>(k) > std::numeric_limits<Index>::max()) return;
+				}
+
+				for (const auto k : corners)
+				{
+					indices.push_back(static_cast<Index>(k));
+					needed = std::max(needed, static_cast<std::size_t>(k) + 1);
+				}
+				++faceCount;
+
+				if (indices.size() >= blockSize * 3) flushFaces();
+			});
+
+		flushVertices();
+		flushFaces();
+
+		return std::pair{ vertexCount, faceCount };
+	}
+
+	//triangle soup with every corner copied out of the vertex buffer
+	template<typename T = float, typename Index = std::uint32_t>
+	auto expand(const cla::mesh<T, Index>& mesh)
+	{
+		std::vector<cla::tri<T>> tris;
+		tris.reserve(mesh.triangles());
+
+		for (std::size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+		{
+			tris.emplace_back(cla::tri<T>(mesh.vertices[mesh.indices[i]], mesh.vertices[mesh.indices[i + 1]], mesh.vertices[mesh.indices[i + 2]], olc::WHITE, mesh.texture));
 		}
 
 		return tris;
 	}
+
+	inline std::vector<cla::tri<float>> loadOBJ(const std::string& filename)
+	{
+		return cla::expand(cla::loadMesh(filename));
+	}
 }
\ No newline at end of file
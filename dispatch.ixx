@@ -0,0 +1,332 @@
+module;
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define CLA_TARGET(isa)
+#else
+#include <cpuid.h>
+#define CLA_TARGET(isa) __attribute__((target(isa)))
+#endif
+export module dispatch;
+
+import core;
+
+export namespace cla
+{
+	//instruction set tiers for the hot kernels, lowest first; every x86-64 CPU has sse2
+	enum class simd_path { scalar, sse2, avx2, avx512 };
+
+	constexpr auto simd_name(cla::simd_path path) noexcept
+	{
+		switch (path)
+		{
+			case cla::simd_path::sse2: return "sse2";
+			case cla::simd_path::avx2: return "avx2";
+			case cla::simd_path::avx512: return "avx512";
+			default: return "scalar";
+		}
+	}
+
+	inline auto cpuid(unsigned leaf, unsigned sub) noexcept
+	{
+		std::array<unsigned, 4> regs{};
+
+#if defined(_MSC_VER)
+		int r[4];
+		__cpuidex(r, (int)leaf, (int)sub);
+
+		for (auto i = 0; i < 4; ++i) regs[i] = (unsigned)r[i];
+#else
+		if (leaf <= __get_cpuid_max(leaf & 0x80000000u, nullptr)) __cpuid_count(leaf, sub, regs[0], regs[1], regs[2], regs[3]);
+#endif
+
+		return regs;
+	}
+
+	CLA_TARGET("xsave") inline unsigned long long read_xcr0() noexcept { return _xgetbv(0); }
+
+	//widest tier both the CPU and the OS (saved register state in xcr0) support
+	inline auto simd_detect() noexcept
+	{
+		const auto leaf1 = cla::cpuid(1, 0);
+
+		if (!(leaf1[3] & (1u << 26))) return cla::simd_path::scalar;
+
+		const bool osxsave = leaf1[2] & (1u << 27);
+		const bool avx = leaf1[2] & (1u << 28);
+		const bool fma = leaf1[2] & (1u << 12);
+
+		if (!osxsave || !avx || !fma) return cla::simd_path::sse2;
+
+		const auto xcr0 = cla::read_xcr0();
+		const auto leaf7 = cla::cpuid(7, 0);
+
+		if ((xcr0 & 0x6) != 0x6 || !(leaf7[1] & (1u << 5))) return cla::simd_path::sse2;
+
+		if ((xcr0 & 0xE6) == 0xE6 && (leaf7[1] & (1u << 16))) return cla::simd_path::avx512;
+
+		return cla::simd_path::avx2;
+	}
+
+	//detected once on first use; CLA_SIMD=scalar|sse2|avx2|avx512 can lower the tier for benchmarking but never raise it
+	inline auto simd_active() noexcept
+	{
+		static const auto path = []()
+		{
+			auto best = cla::simd_detect();
+
+#pragma warning(suppress: 4996)
+			if (const char* env = std::getenv("CLA_SIMD"))
+			{
+				for (const auto p : { cla::simd_path::scalar, cla::simd_path::sse2, cla::simd_path::avx2, cla::simd_path::avx512 })
+				{
+					if (std::strcmp(env, cla::simd_name(p)) == 0 && p < best) best = p;
+				}
+			}
+
+			return best;
+		}();
+
+		return path;
+	}
+
+	//row-major 4 x 4 float product c = a * b
+	inline void compose4_scalar(const float* a, const float* b, float* c) noexcept
+	{
+		for (auto i = 0; i < 4; ++i)
+		{
+			for (auto j = 0; j < 4; ++j)
+			{
+				c[i * 4 + j] = a[i * 4 + 0] * b[0 * 4 + j] + a[i * 4 + 1] * b[1 * 4 + j] + a[i * 4 + 2] * b[2 * 4 + j] + a[i * 4 + 3] * b[3 * 4 + j];
+			}
+		}
+	}
+
+	inline void compose4_sse2(const float* a, const float* b, float* c) noexcept
+	{
+		const __m128 row0 = _mm_loadu_ps(b + 0), row1 = _mm_loadu_ps(b + 4), row2 = _mm_loadu_ps(b + 8), row3 = _mm_loadu_ps(b + 12);
+
+		for (auto i = 0; i < 4; ++i)
+		{
+			__m128 sum = _mm_mul_ps(_mm_set1_ps(a[i * 4 + 0]), row0);
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(a[i * 4 + 1]), row1));
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(a[i * 4 + 2]), row2));
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(a[i * 4 + 3]), row3));
+
+			_mm_storeu_ps(c + i * 4, sum);
+		}
+	}
+
+	//two rows of a per register; permute splats a[i][k] inside each 128-bit half against a broadcast row k of b
+	CLA_TARGET("avx2,fma") inline void compose4_avx2(const float* a, const float* b, float* c) noexcept
+	{
+		const __m256 a01 = _mm256_loadu_ps(a + 0), a23 = _mm256_loadu_ps(a + 8);
+
+		const __m256 row0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(b + 0));
+		const __m256 row1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(b + 4));
+		const __m256 row2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(b + 8));
+		const __m256 row3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(b + 12));
+
+		__m256 c01 = _mm256_mul_ps(_mm256_permute_ps(a01, 0x00), row0);
+		__m256 c23 = _mm256_mul_ps(_mm256_permute_ps(a23, 0x00), row0);
+		c01 = _mm256_fmadd_ps(_mm256_permute_ps(a01, 0x55), row1, c01);
+		c23 = _mm256_fmadd_ps(_mm256_permute_ps(a23, 0x55), row1, c23);
+		c01 = _mm256_fmadd_ps(_mm256_permute_ps(a01, 0xAA), row2, c01);
+		c23 = _mm256_fmadd_ps(_mm256_permute_ps(a23, 0xAA), row2, c23);
+		c01 = _mm256_fmadd_ps(_mm256_permute_ps(a01, 0xFF), row3, c01);
+		c23 = _mm256_fmadd_ps(_mm256_permute_ps(a23, 0xFF), row3, c23);
+
+		_mm256_storeu_ps(c + 0, c01);
+		_mm256_storeu_ps(c + 8, c23);
+	}
+
+	//the whole of a in one register
+	CLA_TARGET("avx512f") inline void compose4_avx512(const float* a, const float* b, float* c) noexcept
+	{
+		const __m512 rows = _mm512_loadu_ps(a);
+
+		__m512 sum = _mm512_mul_ps(_mm512_permute_ps(rows, 0x00), _mm512_broadcast_f32x4(_mm_loadu_ps(b + 0)));
+		sum = _mm512_fmadd_ps(_mm512_permute_ps(rows, 0x55), _mm512_broadcast_f32x4(_mm_loadu_ps(b + 4)), sum);
+		sum = _mm512_fmadd_ps(_mm512_permute_ps(rows, 0xAA), _mm512_broadcast_f32x4(_mm_loadu_ps(b + 8)), sum);
+		sum = _mm512_fmadd_ps(_mm512_permute_ps(rows, 0xFF), _mm512_broadcast_f32x4(_mm_loadu_ps(b + 12)), sum);
+
+		_mm512_storeu_ps(c, sum);
+	}
+
+	//count packed (x, y, z, w) vertices as rows against m with w taken as 1; in and out may alias
+	inline void transform_scalar(const float* in, float* out, std::size_t count, const float* m) noexcept
+	{
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			const float x = in[i * 4 + 0], y = in[i * 4 + 1], z = in[i * 4 + 2];
+
+			for (auto j = 0; j < 4; ++j)
+			{
+				out[i * 4 + j] = x * m[0 * 4 + j] + y * m[1 * 4 + j] + z * m[2 * 4 + j] + m[3 * 4 + j];
+			}
+		}
+	}
+
+	inline void transform_sse2(const float* in, float* out, std::size_t count, const float* m) noexcept
+	{
+		const __m128 row0 = _mm_loadu_ps(m + 0), row1 = _mm_loadu_ps(m + 4), row2 = _mm_loadu_ps(m + 8), row3 = _mm_loadu_ps(m + 12);
+
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			const __m128 v = _mm_loadu_ps(in + i * 4);
+
+			__m128 r = _mm_add_ps(_mm_mul_ps(_mm_shuffle_ps(v, v, 0x00), row0), row3);
+			r = _mm_add_ps(_mm_mul_ps(_mm_shuffle_ps(v, v, 0x55), row1), r);
+			r = _mm_add_ps(_mm_mul_ps(_mm_shuffle_ps(v, v, 0xAA), row2), r);
+
+			_mm_storeu_ps(out + i * 4, r);
+		}
+	}
+
+	//four vertices per iteration in two registers, sse tail
+	CLA_TARGET("avx2,fma") inline void transform_avx2(const float* in, float* out, std::size_t count, const float* m) noexcept
+	{
+		const __m256 wrow0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m + 0));
+		const __m256 wrow1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m + 4));
+		const __m256 wrow2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m + 8));
+		const __m256 wrow3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m + 12));
+
+		std::size_t i = 0;
+
+		for (; i + 4 <= count; i += 4)
+		{
+			const __m256 v0 = _mm256_loadu_ps(in + i * 4 + 0);
+			const __m256 v1 = _mm256_loadu_ps(in + i * 4 + 8);
+
+			__m256 r0 = _mm256_fmadd_ps(_mm256_permute_ps(v0, 0x00), wrow0, wrow3);
+			__m256 r1 = _mm256_fmadd_ps(_mm256_permute_ps(v1, 0x00), wrow0, wrow3);
+			r0 = _mm256_fmadd_ps(_mm256_permute_ps(v0, 0x55), wrow1, r0);
+			r1 = _mm256_fmadd_ps(_mm256_permute_ps(v1, 0x55), wrow1, r1);
+			r0 = _mm256_fmadd_ps(_mm256_permute_ps(v0, 0xAA), wrow2, r0);
+			r1 = _mm256_fmadd_ps(_mm256_permute_ps(v1, 0xAA), wrow2, r1);
+
+			_mm256_storeu_ps(out + i * 4 + 0, r0);
+			_mm256_storeu_ps(out + i * 4 + 8, r1);
+		}
+
+		const __m128 row0 = _mm_loadu_ps(m + 0), row1 = _mm_loadu_ps(m + 4), row2 = _mm_loadu_ps(m + 8), row3 = _mm_loadu_ps(m + 12);
+
+		for (; i < count; ++i)
+		{
+			const __m128 v = _mm_loadu_ps(in + i * 4);
+
+			__m128 r = _mm_fmadd_ps(_mm_shuffle_ps(v, v, 0x00), row0, row3);
+			r = _mm_fmadd_ps(_mm_shuffle_ps(v, v, 0x55), row1, r);
+			r = _mm_fmadd_ps(_mm_shuffle_ps(v, v, 0xAA), row2, r);
+
+			_mm_storeu_ps(out + i * 4, r);
+		}
+	}
+
+	//four vertices per register; the last partial register is handled with a masked load and store
+	CLA_TARGET("avx512f") inline void transform_avx512(const float* in, float* out, std::size_t count, const float* m) noexcept
+	{
+		const __m512 row0 = _mm512_broadcast_f32x4(_mm_loadu_ps(m + 0));
+		const __m512 row1 = _mm512_broadcast_f32x4(_mm_loadu_ps(m + 4));
+		const __m512 row2 = _mm512_broadcast_f32x4(_mm_loadu_ps(m + 8));
+		const __m512 row3 = _mm512_broadcast_f32x4(_mm_loadu_ps(m + 12));
+
+		for (std::size_t i = 0; i < count; i += 4)
+		{
+			const __mmask16 mask = (count - i >= 4) ? (__mmask16)0xFFFF : (__mmask16)((1u << ((count - i) * 4)) - 1);
+
+			const __m512 v = _mm512_maskz_loadu_ps(mask, in + i * 4);
+
+			__m512 r = _mm512_fmadd_ps(_mm512_permute_ps(v, 0x00), row0, row3);
+			r = _mm512_fmadd_ps(_mm512_permute_ps(v, 0x55), row1, r);
+			r = _mm512_fmadd_ps(_mm512_permute_ps(v, 0xAA), row2, r);
+
+			_mm512_mask_storeu_ps(out + i * 4, mask, r);
+		}
+	}
+
+	//structure-of-arrays normalize over n lanes; n is a multiple of vertex_soa<float>::lanes so no variant needs a tail
+	inline void normalize_scalar(const float* x, const float* y, const float* z, float* ox, float* oy, float* oz, std::size_t n) noexcept
+	{
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			const float len = std::sqrt(x[i] * x[i] + y[i] * y[i] + z[i] * z[i]);
+
+			ox[i] = x[i] / len;
+			oy[i] = y[i] / len;
+			oz[i] = z[i] / len;
+		}
+	}
+
+	inline void normalize_sse2(const float* x, const float* y, const float* z, float* ox, float* oy, float* oz, std::size_t n) noexcept
+	{
+		for (std::size_t i = 0; i < n; i += 4)
+		{
+			const __m128 vx = _mm_loadu_ps(x + i), vy = _mm_loadu_ps(y + i), vz = _mm_loadu_ps(z + i);
+
+			const __m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz)));
+
+			_mm_storeu_ps(ox + i, _mm_div_ps(vx, len));
+			_mm_storeu_ps(oy + i, _mm_div_ps(vy, len));
+			_mm_storeu_ps(oz + i, _mm_div_ps(vz, len));
+		}
+	}
+
+	CLA_TARGET("avx2,fma") inline void normalize_avx2(const float* x, const float* y, const float* z, float* ox, float* oy, float* oz, std::size_t n) noexcept
+	{
+		for (std::size_t i = 0; i < n; i += 8)
+		{
+			const __m256 vx = _mm256_loadu_ps(x + i), vy = _mm256_loadu_ps(y + i), vz = _mm256_loadu_ps(z + i);
+
+			const __m256 len = _mm256_sqrt_ps(_mm256_fmadd_ps(vz, vz, _mm256_fmadd_ps(vy, vy, _mm256_mul_ps(vx, vx))));
+
+			_mm256_storeu_ps(ox + i, _mm256_div_ps(vx, len));
+			_mm256_storeu_ps(oy + i, _mm256_div_ps(vy, len));
+			_mm256_storeu_ps(oz + i, _mm256_div_ps(vz, len));
+		}
+	}
+
+	CLA_TARGET("avx512f") inline void normalize_avx512(const float* x, const float* y, const float* z, float* ox, float* oy, float* oz, std::size_t n) noexcept
+	{
+		for (std::size_t i = 0; i < n; i += 16)
+		{
+			const __m512 vx = _mm512_loadu_ps(x + i), vy = _mm512_loadu_ps(y + i), vz = _mm512_loadu_ps(z + i);
+
+			const __m512 len = _mm512_sqrt_ps(_mm512_fmadd_ps(vz, vz, _mm512_fmadd_ps(vy, vy, _mm512_mul_ps(vx, vx))));
+
+			_mm512_storeu_ps(ox + i, _mm512_div_ps(vx, len));
+			_mm512_storeu_ps(oy + i, _mm512_div_ps(vy, len));
+			_mm512_storeu_ps(oz + i, _mm512_div_ps(vz, len));
+		}
+	}
+
+	struct simd_kernels
+	{
+		void (*compose4)(const float*, const float*, float*) noexcept;
+		void (*transform)(const float*, float*, std::size_t, const float*) noexcept;
+		void (*normalize)(const float*, const float*, const float*, float*, float*, float*, std::size_t) noexcept;
+	};
+
+	constexpr auto simd_kernels_for(cla::simd_path path) noexcept
+	{
+		switch (path)
+		{
+			case cla::simd_path::sse2: return cla::simd_kernels{ cla::compose4_sse2, cla::transform_sse2, cla::normalize_sse2 };
+			case cla::simd_path::avx2: return cla::simd_kernels{ cla::compose4_avx2, cla::transform_avx2, cla::normalize_avx2 };
+			case cla::simd_path::avx512: return cla::simd_kernels{ cla::compose4_avx512, cla::transform_avx512, cla::normalize_avx512 };
+			default: return cla::simd_kernels{ cla::compose4_scalar, cla::transform_scalar, cla::normalize_scalar };
+		}
+	}
+
+	//kernel table for simd_active(), filled in once
+	inline const auto& simd_table() noexcept
+	{
+		static const auto table = cla::simd_kernels_for(cla::simd_active());
+
+		return table;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,146 @@
+module;
+#include <algorithm>
+#include <functional>
+#include <vector>
+#include <memory>
+export module dmatrix;
+
+import core;
+import matrix;
+
+export namespace cla
+{
+	//runtime-sized row-major matrix on the heap; Alloc may be cla::arena_allocator<T> to carve storage out of a cla::arena
+	template<typename T = float, typename Alloc = cla::aligned_allocator<T>>
+	class dmatrix
+	{
+	public:
+		std::size_t rows = 0, cols = 0;
+
+		std::vector<T, Alloc> data;
+
+		dmatrix() = default;
+
+		dmatrix(std::size_t rows, std::size_t cols, const Alloc& alloc = Alloc{}) : rows(rows), cols(cols), data(rows * cols, (T)0.0f, alloc) {}
+
+		T& operator()(std::size_t i, std::size_t j) noexcept { return data[i * cols + j]; }
+		const T& operator()(std::size_t i, std::size_t j) const noexcept { return data[i * cols + j]; }
+
+		T* row(std::size_t i) noexcept { return data.data() + i * cols; }
+		const T* row(std::size_t i) const noexcept { return data.data() + i * cols; }
+
+		bool empty() const noexcept { return data.empty(); }
+	};
+
+	using dmatrixf = dmatrix<float>;
+	using dmatrixd = dmatrix<double>;
+
+	//products below this many multiply-adds are not worth spreading across threads
+	constexpr auto dmatrix_parallel_flops = static_cast<std::size_t>(1 << 21);
+
+	//element-wise passes such as transpose, counted in elements rather than flops; below this the matrix
+	//still fits in L2 and thread start-up costs more than the copy
+	constexpr auto dmatrix_parallel_elements = static_cast<std::size_t>(1 << 18);
+
+	template<typename binaryop = std::multiplies<void>, typename T = float, typename Alloc>
+	auto apply(const cla::dmatrix<T, Alloc>& mat1, const T& operand)
+	{
+		cla::dmatrix<T, Alloc> mat(mat1.rows, mat1.cols, mat1.data.get_allocator());
+
+		for (std::size_t i = 0; i < mat1.data.size(); ++i)
+		{
+			mat.data[i] = binaryop{}(mat1.data[i], operand);
+		}
+
+		return mat;
+	}
+
+	//mismatched shapes give an empty matrix
+	template<typename binaryop = std::multiplies<void>, typename T = float, typename Alloc>
+	auto reduce(const cla::dmatrix<T, Alloc>& mat1, const cla::dmatrix<T, Alloc>& mat2)
+	{
+		if (mat1.rows != mat2.rows || mat1.cols != mat2.cols) return cla::dmatrix<T, Alloc>{ 0, 0, mat1.data.get_allocator() };
+
+		cla::dmatrix<T, Alloc> mat(mat1.rows, mat1.cols, mat1.data.get_allocator());
+
+		for (std::size_t i = 0; i < mat1.data.size(); ++i)
+		{
+			mat.data[i] = binaryop{}(mat1.data[i], mat2.data[i]);
+		}
+
+		return mat;
+	}
+
+	//32 x 32 tiles keep both the source rows and destination columns in L1
+	template<typename T = float, typename Alloc>
+	auto transpose(const cla::dmatrix<T, Alloc>& mat1)
+	{
+		constexpr std::size_t tile = 32;
+
+		cla::dmatrix<T, Alloc> mat(mat1.cols, mat1.rows, mat1.data.get_allocator());
+
+		const auto tiles = (mat1.rows + tile - 1) / tile;
+
+		cla::parallel_for(tiles, (mat1.rows * mat1.cols >= cla::dmatrix_parallel_elements) ? 1 : tiles, [&](std::size_t begin, std::size_t end)
+		{
+			for (auto ii = begin * tile; ii < std::min(end * tile, mat1.rows); ii += tile)
+			{
+				for (std::size_t jj = 0; jj < mat1.cols; jj += tile)
+				{
+					for (auto i = ii; i < std::min(ii + tile, mat1.rows); ++i)
+					{
+						for (auto j = jj; j < std::min(jj + tile, mat1.cols); ++j)
+						{
+							mat(j, i) = mat1(i, j);
+						}
+					}
+				}
+			}
+		});
+
+		return mat;
+	}
+
+	//blocked product; with Parallel, row panels of the result are split across hardware threads
+	//mismatched inner dimensions give an empty matrix
+	template<bool Parallel = true, typename T = float, typename Alloc>
+	auto compose(const cla::dmatrix<T, Alloc>& mat1, const cla::dmatrix<T, Alloc>& mat2)
+	{
+		if (mat1.cols != mat2.rows) return cla::dmatrix<T, Alloc>{ 0, 0, mat1.data.get_allocator() };
+
+		cla::dmatrix<T, Alloc> mat(mat1.rows, mat2.cols, mat1.data.get_allocator());
+
+		const auto m = mat1.rows, k = mat1.cols, n = mat2.cols;
+
+		//work is handed out in panels of four rows so every thread runs whole register tiles
+		const auto panels = (m + 3) / 4;
+		const auto grain = (Parallel && m * k * n >= cla::dmatrix_parallel_flops) ? 1 : panels;
+
+		cla::parallel_for(panels, grain, [&](std::size_t begin, std::size_t end)
+		{
+			const auto r0 = begin * 4, r1 = std::min(end * 4, m);
+
+			cla::gemm_blocked(mat1.row(r0), k, mat2.row(0), n, mat.row(r0), n, r1 - r0, k, n);
+		});
+
+		return mat;
+	}
+
+	template<typename T = float, typename Alloc>
+	auto operator*(const cla::dmatrix<T, Alloc>& mat1, const cla::dmatrix<T, Alloc>& mat2)
+	{
+		return cla::compose(mat1, mat2);
+	}
+
+	template<typename T = float, typename Alloc>
+	auto operator+(const cla::dmatrix<T, Alloc>& mat1, const cla::dmatrix<T, Alloc>& mat2)
+	{
+		return cla::reduce<std::plus<>>(mat1, mat2);
+	}
+
+	template<typename T = float, typename Alloc>
+	auto operator-(const cla::dmatrix<T, Alloc>& mat1, const cla::dmatrix<T, Alloc>& mat2)
+	{
+		return cla::reduce<std::minus<>>(mat1, mat2);
+	}
+}
\ No newline at end of file
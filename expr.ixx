@@ -0,0 +1,208 @@
+module;
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+#include <vector>
+#include <limits>
+export module expr;
+
+import core;
+import dmatrix;
+
+export namespace cla
+{
+	//element access for every container the lazy layer can read from or assign into; elements are numbered row-major
+	template<typename T = float>
+	constexpr auto& element(cla::v3d_generic<T>& vec, std::size_t i) noexcept { return (i == 0) ? vec.x : (i == 1) ? vec.y : vec.z; }
+
+	template<typename T = float>
+	constexpr const auto& element(const cla::v3d_generic<T>& vec, std::size_t i) noexcept { return (i == 0) ? vec.x : (i == 1) ? vec.y : vec.z; }
+
+	template<typename T = float, std::size_t R, std::size_t C>
+	constexpr auto& element(cla::matrix<T, R, C>& mat, std::size_t i) noexcept { return mat.data[i / C][i % C]; }
+
+	template<typename T = float, std::size_t R, std::size_t C>
+	constexpr const auto& element(const cla::matrix<T, R, C>& mat, std::size_t i) noexcept { return mat.data[i / C][i % C]; }
+
+	template<typename T = float, typename Alloc>
+	constexpr auto& element(cla::dmatrix<T, Alloc>& mat, std::size_t i) noexcept { return mat.data[i]; }
+
+	template<typename T = float, typename Alloc>
+	constexpr const auto& element(const cla::dmatrix<T, Alloc>& mat, std::size_t i) noexcept { return mat.data[i]; }
+
+	template<typename T = float, typename Alloc>
+	constexpr auto& element(std::vector<T, Alloc>& vec, std::size_t i) noexcept { return vec[i]; }
+
+	template<typename T = float, typename Alloc>
+	constexpr const auto& element(const std::vector<T, Alloc>& vec, std::size_t i) noexcept { return vec[i]; }
+
+	template<typename T = float>
+	constexpr std::size_t extent(const cla::v3d_generic<T>&) noexcept { return 3; }
+
+	template<typename T = float, std::size_t R, std::size_t C>
+	constexpr std::size_t extent(const cla::matrix<T, R, C>&) noexcept { return R * C; }
+
+	template<typename T = float, typename Alloc>
+	constexpr std::size_t extent(const cla::dmatrix<T, Alloc>& mat) noexcept { return mat.data.size(); }
+
+	template<typename T = float, typename Alloc>
+	constexpr std::size_t extent(const std::vector<T, Alloc>& vec) noexcept { return vec.size(); }
+
+	//an empty container of the same type and shape, used as the destination of evaluate()
+	template<typename T = float>
+	constexpr auto shaped_like(const cla::v3d_generic<T>&) noexcept { return cla::v3d_generic<T>{}; }
+
+	template<typename T = float, std::size_t R, std::size_t C>
+	constexpr auto shaped_like(const cla::matrix<T, R, C>&) noexcept { return cla::matrix<T, R, C>{}; }
+
+	template<typename T = float, typename Alloc>
+	auto shaped_like(const cla::dmatrix<T, Alloc>& mat) { return cla::dmatrix<T, Alloc>(mat.rows, mat.cols, mat.data.get_allocator()); }
+
+	template<typename T = float, typename Alloc>
+	constexpr auto shaped_like(const std::vector<T, Alloc>& vec) { return std::vector<T, Alloc>(vec.size(), vec.get_allocator()); }
+
+	template<typename E>
+	concept expression = requires { typename std::remove_cvref_t<E>::expression_tag; };
+
+	template<typename E>
+	concept scalar_operand = std::is_arithmetic_v<std::remove_cvref_t<E>>;
+
+	//operands are held by pointer, so the containers must outlive the expression built over them
+	template<typename V>
+	struct leaf_expr
+	{
+		using expression_tag = void;
+
+		const V* ref;
+
+		constexpr auto operator[](std::size_t i) const noexcept { return cla::element(*ref, i); }
+		constexpr std::size_t size() const noexcept { return cla::extent(*ref); }
+		constexpr const V& origin() const noexcept { return *ref; }
+	};
+
+	template<typename T>
+	struct scalar_expr
+	{
+		using expression_tag = void;
+		using scalar_tag = void;
+
+		T value;
+
+		constexpr auto operator[](std::size_t) const noexcept { return value; }
+		constexpr std::size_t size() const noexcept { return std::numeric_limits<std::size_t>::max(); }
+	};
+
+	template<typename binaryop, typename L, typename R>
+	struct binary_expr
+	{
+		using expression_tag = void;
+
+		L lhs;
+		R rhs;
+
+		constexpr auto operator[](std::size_t i) const noexcept { return binaryop{}(lhs[i], rhs[i]); }
+		constexpr std::size_t size() const noexcept { return std::min(lhs.size(), rhs.size()); }
+
+		constexpr const auto& origin() const noexcept
+		{
+			if constexpr (requires { typename L::scalar_tag; }) return rhs.origin();
+			else return lhs.origin();
+		}
+	};
+
+	template<typename unaryop, typename E>
+	struct unary_expr
+	{
+		using expression_tag = void;
+
+		E inner;
+		unaryop op;
+
+		constexpr auto operator[](std::size_t i) const noexcept { return op(inner[i]); }
+		constexpr std::size_t size() const noexcept { return inner.size(); }
+		constexpr const auto& origin() const noexcept { return inner.origin(); }
+	};
+
+	//opts a container into the lazy layer; nothing is computed until assign() or evaluate()
+	template<typename V>
+	constexpr auto lazy(const V& vec) noexcept
+	{
+		return cla::leaf_expr<V>{ &vec };
+	}
+
+	template<typename E>
+	constexpr auto as_expression(const E& operand) noexcept
+	{
+		if constexpr (cla::expression<E>) return operand;
+		else return cla::scalar_expr<E>{ operand };
+	}
+
+	template<typename binaryop, typename L, typename R>
+	constexpr auto combine(const L& lhs, const R& rhs) noexcept
+	{
+		using lhs_t = decltype(cla::as_expression(lhs));
+		using rhs_t = decltype(cla::as_expression(rhs));
+
+		return cla::binary_expr<binaryop, lhs_t, rhs_t>{ cla::as_expression(lhs), cla::as_expression(rhs) };
+	}
+
+	template<typename E, typename unaryop>
+	constexpr auto map(const E& expr, unaryop op) noexcept requires cla::expression<E>
+	{
+		return cla::unary_expr<unaryop, E>{ expr, op };
+	}
+
+	template<typename L, typename R>
+	constexpr auto operator+(const L& lhs, const R& rhs) noexcept requires (cla::expression<L> || cla::expression<R>) && (cla::expression<L> || cla::scalar_operand<L>) && (cla::expression<R> || cla::scalar_operand<R>)
+	{
+		return cla::combine<std::plus<>>(lhs, rhs);
+	}
+
+	template<typename L, typename R>
+	constexpr auto operator-(const L& lhs, const R& rhs) noexcept requires (cla::expression<L> || cla::expression<R>) && (cla::expression<L> || cla::scalar_operand<L>) && (cla::expression<R> || cla::scalar_operand<R>)
+	{
+		return cla::combine<std::minus<>>(lhs, rhs);
+	}
+
+	template<typename L, typename R>
+	constexpr auto operator*(const L& lhs, const R& rhs) noexcept requires (cla::expression<L> || cla::expression<R>) && (cla::expression<L> || cla::scalar_operand<L>) && (cla::expression<R> || cla::scalar_operand<R>)
+	{
+		return cla::combine<std::multiplies<>>(lhs, rhs);
+	}
+
+	template<typename L, typename R>
+	constexpr auto operator/(const L& lhs, const R& rhs) noexcept requires (cla::expression<L> || cla::expression<R>) && (cla::expression<L> || cla::scalar_operand<L>) && (cla::expression<R> || cla::scalar_operand<R>)
+	{
+		return cla::combine<std::divides<>>(lhs, rhs);
+	}
+
+	template<typename E>
+	constexpr auto operator-(const E& expr) noexcept requires cla::expression<E>
+	{
+		return cla::map(expr, std::negate<>{});
+	}
+
+	//the single fused pass: every element of target is written once from the whole expression tree
+	template<typename V, typename E>
+	constexpr auto& assign(V& target, const E& expr) noexcept requires cla::expression<E>
+	{
+		const auto count = std::min(cla::extent(target), expr.size());
+
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			cla::element(target, i) = expr[i];
+		}
+
+		return target;
+	}
+
+	template<typename E>
+	constexpr auto evaluate(const E& expr) requires cla::expression<E>
+	{
+		auto out = cla::shaped_like(expr.origin());
+
+		cla::assign(out, expr);
+
+		return out;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,121 @@
+module;
+#include <type_traits>
+#include <cstddef>
+#include <immintrin.h>
+export module lanes;
+
+import stdex;
+
+export namespace cla
+{
+	//lane primitives shared by the batched kernels; a kernel written against pack P runs unchanged on plain scalars for tails and other types
+	template<typename T>
+	constexpr auto lane_select(bool mask, const T& a, const T& b) noexcept { return mask ? a : b; }
+
+	template<typename T>
+	constexpr auto lane_sqrt(const T& a) noexcept { return std::my_sqrt(a); }
+
+	template<typename T>
+	constexpr auto lane_abs(const T& a) noexcept { return std::my_abs(a); }
+
+	template<typename P, typename T>
+	constexpr auto lane_load(const T* src) noexcept { return P(*src); }
+
+	template<typename T>
+	constexpr auto lane_store(T* dst, const T& a) noexcept { *dst = a; }
+
+#if defined(__AVX__)
+	struct float_x8
+	{
+		__m256 v;
+
+		float_x8() = default;
+		float_x8(float s) noexcept : v(_mm256_set1_ps(s)) {}
+		float_x8(__m256 r) noexcept : v(r) {}
+
+		friend float_x8 operator+(float_x8 a, float_x8 b) noexcept { return _mm256_add_ps(a.v, b.v); }
+		friend float_x8 operator-(float_x8 a, float_x8 b) noexcept { return _mm256_sub_ps(a.v, b.v); }
+		friend float_x8 operator*(float_x8 a, float_x8 b) noexcept { return _mm256_mul_ps(a.v, b.v); }
+		friend float_x8 operator/(float_x8 a, float_x8 b) noexcept { return _mm256_div_ps(a.v, b.v); }
+		friend float_x8 operator-(float_x8 a) noexcept { return _mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f)); }
+
+		float_x8& operator+=(float_x8 b) noexcept { v = _mm256_add_ps(v, b.v); return *this; }
+		float_x8& operator-=(float_x8 b) noexcept { v = _mm256_sub_ps(v, b.v); return *this; }
+		float_x8& operator*=(float_x8 b) noexcept { v = _mm256_mul_ps(v, b.v); return *this; }
+		float_x8& operator/=(float_x8 b) noexcept { v = _mm256_div_ps(v, b.v); return *this; }
+
+		friend float_x8 operator>(float_x8 a, float_x8 b) noexcept { return _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ); }
+		friend float_x8 operator==(float_x8 a, float_x8 b) noexcept { return _mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ); }
+	};
+
+	struct double_x4
+	{
+		__m256d v;
+
+		double_x4() = default;
+		double_x4(double s) noexcept : v(_mm256_set1_pd(s)) {}
+		double_x4(__m256d r) noexcept : v(r) {}
+
+		friend double_x4 operator+(double_x4 a, double_x4 b) noexcept { return _mm256_add_pd(a.v, b.v); }
+		friend double_x4 operator-(double_x4 a, double_x4 b) noexcept { return _mm256_sub_pd(a.v, b.v); }
+		friend double_x4 operator*(double_x4 a, double_x4 b) noexcept { return _mm256_mul_pd(a.v, b.v); }
+		friend double_x4 operator/(double_x4 a, double_x4 b) noexcept { return _mm256_div_pd(a.v, b.v); }
+		friend double_x4 operator-(double_x4 a) noexcept { return _mm256_xor_pd(a.v, _mm256_set1_pd(-0.0)); }
+
+		double_x4& operator+=(double_x4 b) noexcept { v = _mm256_add_pd(v, b.v); return *this; }
+		double_x4& operator-=(double_x4 b) noexcept { v = _mm256_sub_pd(v, b.v); return *this; }
+		double_x4& operator*=(double_x4 b) noexcept { v = _mm256_mul_pd(v, b.v); return *this; }
+		double_x4& operator/=(double_x4 b) noexcept { v = _mm256_div_pd(v, b.v); return *this; }
+
+		friend double_x4 operator>(double_x4 a, double_x4 b) noexcept { return _mm256_cmp_pd(a.v, b.v, _CMP_GT_OQ); }
+		friend double_x4 operator==(double_x4 a, double_x4 b) noexcept { return _mm256_cmp_pd(a.v, b.v, _CMP_EQ_OQ); }
+	};
+
+	inline auto lane_select(float_x8 mask, float_x8 a, float_x8 b) noexcept { return float_x8(_mm256_blendv_ps(b.v, a.v, mask.v)); }
+	inline auto lane_sqrt(float_x8 a) noexcept { return float_x8(_mm256_sqrt_ps(a.v)); }
+	inline auto lane_abs(float_x8 a) noexcept { return float_x8(_mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v)); }
+
+	inline auto lane_select(double_x4 mask, double_x4 a, double_x4 b) noexcept { return double_x4(_mm256_blendv_pd(b.v, a.v, mask.v)); }
+	inline auto lane_sqrt(double_x4 a) noexcept { return double_x4(_mm256_sqrt_pd(a.v)); }
+	inline auto lane_abs(double_x4 a) noexcept { return double_x4(_mm256_andnot_pd(_mm256_set1_pd(-0.0), a.v)); }
+
+	template<>
+	inline auto lane_load<cla::float_x8, float>(const float* src) noexcept { return cla::float_x8(_mm256_loadu_ps(src)); }
+
+	template<>
+	inline auto lane_load<cla::double_x4, double>(const double* src) noexcept { return cla::double_x4(_mm256_loadu_pd(src)); }
+
+	inline auto lane_store(float* dst, cla::float_x8 a) noexcept { _mm256_storeu_ps(dst, a.v); }
+	inline auto lane_store(double* dst, cla::double_x4 a) noexcept { _mm256_storeu_pd(dst, a.v); }
+#endif
+
+	//widest pack for T on this build, and how many elements it holds
+	template<typename T>
+	struct lane_traits
+	{
+		using pack = T;
+		static constexpr std::size_t width = 1;
+	};
+
+#if defined(__AVX__)
+	template<>
+	struct lane_traits<float>
+	{
+		using pack = cla::float_x8;
+		static constexpr std::size_t width = 8;
+	};
+
+	template<>
+	struct lane_traits<double>
+	{
+		using pack = cla::double_x4;
+		static constexpr std::size_t width = 4;
+	};
+#endif
+
+	template<typename T>
+	using lane_pack = typename cla::lane_traits<T>::pack;
+
+	template<typename T>
+	constexpr auto lane_width = cla::lane_traits<T>::width;
+}
\ No newline at end of file
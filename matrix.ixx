@@ -4,9 +4,14 @@ module;
 #include <array>
 #include <tuple>
 #include <cmath>
+#include <type_traits>
+#include <utility>
+#include <span>
+#include <immintrin.h>
 export module matrix;
 
 import core;
+import dispatch;
 import trig;
 import vector;
 
@@ -14,30 +19,30 @@ import vector;
 
 export namespace cla
 {
-	template<typename binaryop = std::multiplies<void>, typename T = float, std::size_t S>
-	constexpr auto apply(const cla::matrix<T, S>& mat1, const T& operand)
+	template<typename binaryop = std::multiplies<void>, typename T = float, std::size_t R, std::size_t C>
+	constexpr auto apply(const cla::matrix<T, R, C>& mat1, const T& operand)
 	{
-		cla::matrix<T, S> mat;
+		cla::matrix<T, R, C> mat;
 
-		for (auto i = 0; i < S; ++i)
+		for (auto i = 0; i < R; ++i)
 		{
-			for (auto j = 0; j < S; ++j)
+			for (auto j = 0; j < C; ++j)
 			{
-				mat[i][j] = binaryop{}(mat[i][j], operand);
+				mat.data[i][j] = binaryop{}(mat1.data[i][j], operand);
 			}
 		}
 
 		return mat;
 	}
 
-	template<typename binaryop = std::multiplies<void>, typename T = float, std::size_t S>
-	constexpr auto reduce(const cla::matrix<T, S>& mat1, const cla::matrix<T, S>& mat2)
+	template<typename binaryop = std::multiplies<void>, typename T = float, std::size_t R, std::size_t C>
+	constexpr auto reduce(const cla::matrix<T, R, C>& mat1, const cla::matrix<T, R, C>& mat2)
 	{
-		cla::matrix<T, S> mat;
+		cla::matrix<T, R, C> mat;
 
-		for (auto i = 0; i < S; ++i)
+		for (auto i = 0; i < R; ++i)
 		{
-			for (auto j = 0; j < S; ++j)
+			for (auto j = 0; j < C; ++j)
 			{
 				mat.data[i][j] = binaryop{}(mat1.data[i][j], mat2.data[i][j]);
 			}
@@ -46,18 +51,251 @@ export namespace cla
 		return mat;
 	}
 
-	template<typename T = float, std::size_t S = 4>
-	constexpr auto compose(const cla::matrix<T, S>& mat1, const cla::matrix<T, S>& mat2) noexcept
+	template<typename T = float, std::size_t R, std::size_t C>
+	constexpr auto transpose(const cla::matrix<T, R, C>& mat1) noexcept
 	{
-		cla::matrix<T, S> mat;
+		cla::matrix<T, C, R> mat;
 
-		for (auto i = 0; i < S; i++)
+		for (auto i = 0; i < R; ++i)
 		{
-			for (auto j = 0; j < S; j++)
+			for (auto j = 0; j < C; ++j)
+			{
+				mat.data[j][i] = mat1.data[i][j];
+			}
+		}
+
+		return mat;
+	}
+
+	//float 4 x 4 goes through the runtime-selected kernel (see cla::simd_active)
+	inline auto compose_simd(const cla::matrix<float, 4>& mat1, const cla::matrix<float, 4>& mat2) noexcept
+	{
+		cla::matrix<float, 4> mat;
+
+		cla::simd_table().compose4(mat1.data[0].data(), mat2.data[0].data(), mat.data[0].data());
+
+		return mat;
+	}
+
+	//row broadcast kernels; row i of the result is the sum of mat2's rows weighted by mat1[i][k]
+	inline auto compose_simd(const cla::matrix<double, 4>& mat1, const cla::matrix<double, 4>& mat2) noexcept
+	{
+		cla::matrix<double, 4> mat;
+
+#if defined(__AVX__)
+		const __m256d row0 = _mm256_loadu_pd(mat2.data[0].data());
+		const __m256d row1 = _mm256_loadu_pd(mat2.data[1].data());
+		const __m256d row2 = _mm256_loadu_pd(mat2.data[2].data());
+		const __m256d row3 = _mm256_loadu_pd(mat2.data[3].data());
+
+		for (auto i = 0; i < 4; ++i)
+		{
+			__m256d sum = _mm256_mul_pd(_mm256_set1_pd(mat1.data[i][0]), row0);
+#if defined(__FMA__) || defined(__AVX2__)
+			sum = _mm256_fmadd_pd(_mm256_set1_pd(mat1.data[i][1]), row1, sum);
+			sum = _mm256_fmadd_pd(_mm256_set1_pd(mat1.data[i][2]), row2, sum);
+			sum = _mm256_fmadd_pd(_mm256_set1_pd(mat1.data[i][3]), row3, sum);
+#else
+			sum = _mm256_add_pd(sum, _mm256_mul_pd(_mm256_set1_pd(mat1.data[i][1]), row1));
+			sum = _mm256_add_pd(sum, _mm256_mul_pd(_mm256_set1_pd(mat1.data[i][2]), row2));
+			sum = _mm256_add_pd(sum, _mm256_mul_pd(_mm256_set1_pd(mat1.data[i][3]), row3));
+#endif
+			_mm256_storeu_pd(mat.data[i].data(), sum);
+		}
+#else
+		for (auto i = 0; i < 4; ++i)
+		{
+			__m128d lo = _mm_setzero_pd(), hi = _mm_setzero_pd();
+
+			for (auto k = 0; k < 4; ++k)
+			{
+				const __m128d scale = _mm_set1_pd(mat1.data[i][k]);
+
+				lo = _mm_add_pd(lo, _mm_mul_pd(scale, _mm_loadu_pd(&mat2.data[k][0])));
+				hi = _mm_add_pd(hi, _mm_mul_pd(scale, _mm_loadu_pd(&mat2.data[k][2])));
+			}
+
+			_mm_storeu_pd(&mat.data[i][0], lo);
+			_mm_storeu_pd(&mat.data[i][2], hi);
+		}
+#endif
+
+		return mat;
+	}
+
+	//accumulates a 4 x nr register tile of c += a * b over kCount; nr is two vector registers wide
+	//a, b and c point at the tile origin and advance by their row strides lda, ldb and ldc
+	template<typename T, std::size_t NR>
+	inline auto gemm_tile(const T* a, std::size_t lda, const T* b, std::size_t ldb, T* c, std::size_t ldc, std::size_t kCount) noexcept
+	{
+#if defined(__AVX__)
+		if constexpr (std::is_same_v<T, float> || std::is_same_v<T, double>)
+		{
+			using reg = std::conditional_t<std::is_same_v<T, float>, __m256, __m256d>;
+			constexpr auto width = sizeof(reg) / sizeof(T);
+
+			const auto load = [](const T* p) { if constexpr (std::is_same_v<T, float>) return _mm256_loadu_ps(p); else return _mm256_loadu_pd(p); };
+			const auto store = [](T* p, reg v) { if constexpr (std::is_same_v<T, float>) _mm256_storeu_ps(p, v); else _mm256_storeu_pd(p, v); };
+			const auto splat = [](T v) { if constexpr (std::is_same_v<T, float>) return _mm256_set1_ps(v); else return _mm256_set1_pd(v); };
+			const auto madd = [](reg x, reg y, reg z)
+			{
+#if defined(__FMA__) || defined(__AVX2__)
+				if constexpr (std::is_same_v<T, float>) return _mm256_fmadd_ps(x, y, z); else return _mm256_fmadd_pd(x, y, z);
+#else
+				if constexpr (std::is_same_v<T, float>) return _mm256_add_ps(_mm256_mul_ps(x, y), z); else return _mm256_add_pd(_mm256_mul_pd(x, y), z);
+#endif
+			};
+
+			static_assert(NR == 2 * width);
+
+			reg acc[4][2];
+
+			for (auto r = 0; r < 4; ++r)
+			{
+				acc[r][0] = load(c + r * ldc);
+				acc[r][1] = load(c + r * ldc + width);
+			}
+
+			for (std::size_t k = 0; k < kCount; ++k)
+			{
+				const reg b0 = load(b + k * ldb);
+				const reg b1 = load(b + k * ldb + width);
+
+				const reg a0 = splat(a[0 * lda + k]);
+				const reg a1 = splat(a[1 * lda + k]);
+				const reg a2 = splat(a[2 * lda + k]);
+				const reg a3 = splat(a[3 * lda + k]);
+
+				acc[0][0] = madd(a0, b0, acc[0][0]); acc[0][1] = madd(a0, b1, acc[0][1]);
+				acc[1][0] = madd(a1, b0, acc[1][0]); acc[1][1] = madd(a1, b1, acc[1][1]);
+				acc[2][0] = madd(a2, b0, acc[2][0]); acc[2][1] = madd(a2, b1, acc[2][1]);
+				acc[3][0] = madd(a3, b0, acc[3][0]); acc[3][1] = madd(a3, b1, acc[3][1]);
+			}
+
+			for (auto r = 0; r < 4; ++r)
+			{
+				store(c + r * ldc, acc[r][0]);
+				store(c + r * ldc + width, acc[r][1]);
+			}
+
+			return;
+		}
+#endif
+
+		T acc[4][NR];
+
+		for (auto r = 0; r < 4; ++r)
+		{
+			for (auto j = 0; j < NR; ++j)
+			{
+				acc[r][j] = c[r * ldc + j];
+			}
+		}
+
+		for (std::size_t k = 0; k < kCount; ++k)
+		{
+			for (auto r = 0; r < 4; ++r)
+			{
+				const T s = a[r * lda + k];
+
+				for (auto j = 0; j < NR; ++j)
+				{
+					acc[r][j] += s * b[k * ldb + j];
+				}
+			}
+		}
+
+		for (auto r = 0; r < 4; ++r)
+		{
+			for (auto j = 0; j < NR; ++j)
+			{
+				c[r * ldc + j] = acc[r][j];
+			}
+		}
+	}
+
+	//cache-blocked c += a * b for an m x k by k x n product: a kc x nc panel of b stays resident in L2 while 4 x nr register tiles sweep it
+	template<typename T>
+	inline auto gemm_blocked(const T* a, std::size_t lda, const T* b, std::size_t ldb, T* c, std::size_t ldc, std::size_t m, std::size_t k, std::size_t n) noexcept
+	{
+		constexpr std::size_t nr = (std::is_same_v<T, double> ? 8 : 16);
+		constexpr std::size_t kc = 256;
+		constexpr std::size_t nc = (128 * 1024) / (kc * sizeof(T)) / nr * nr;
+
+		for (std::size_t kk = 0; kk < k; kk += kc)
+		{
+			const auto kCount = std::min(kc, k - kk);
+
+			for (std::size_t jj = 0; jj < n; jj += nc)
+			{
+				const auto jEnd = std::min(jj + nc, n);
+
+				for (std::size_t i = 0; i < m; i += 4)
+				{
+					std::size_t j = jj;
+
+					if (i + 4 <= m)
+					{
+						for (; j + nr <= jEnd; j += nr)
+						{
+							cla::gemm_tile<T, nr>(a + i * lda + kk, lda, b + kk * ldb + j, ldb, c + i * ldc + j, ldc, kCount);
+						}
+					}
+
+					//ragged right and bottom edges
+					for (auto r = i; r < std::min(i + 4, m); ++r)
+					{
+						for (auto q = kk; q < kk + kCount; ++q)
+						{
+							const T s = a[r * lda + q];
+
+							for (auto col = j; col < jEnd; ++col)
+							{
+								c[r * ldc + col] += s * b[q * ldb + col];
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	template<typename T, std::size_t R, std::size_t K, std::size_t C>
+	inline auto compose_blocked(const cla::matrix<T, R, K>& mat1, const cla::matrix<T, K, C>& mat2) noexcept
+	{
+		static_assert(sizeof(mat1.data) == R * K * sizeof(T), "matrix rows must be packed");
+
+		cla::matrix<T, R, C> mat;
+
+		for (auto& row : mat.data) row.fill((T)0.0f);
+
+		cla::gemm_blocked(mat1.data[0].data(), K, mat2.data[0].data(), C, mat.data[0].data(), C, R, K, C);
+
+		return mat;
+	}
+
+	template<typename T = float, std::size_t R = 4, std::size_t K = R, std::size_t C = R>
+	constexpr auto compose(const cla::matrix<T, R, K>& mat1, const cla::matrix<T, K, C>& mat2) noexcept
+	{
+		if constexpr (R == 4 && K == 4 && C == 4 && (std::is_same_v<T, float> || std::is_same_v<T, double>))
+		{
+			if (!std::is_constant_evaluated()) return cla::compose_simd(mat1, mat2);
+		}
+
+		if constexpr (R >= 16 && K >= 16 && C >= 16)
+		{
+			if (!std::is_constant_evaluated()) return cla::compose_blocked(mat1, mat2);
+		}
+
+		cla::matrix<T, R, C> mat;
+
+		for (auto i = 0; i < R; i++)
+		{
+			for (auto j = 0; j < C; j++)
 			{
 				T sum = (T)0.0f;
 
-				for (auto k = 0; k < S; k++)
+				for (auto k = 0; k < K; k++)
 				{
 					sum += mat1.data[i][k] * mat2.data[k][j];
 				}
@@ -82,11 +320,13 @@ export namespace cla
 			}
 		}
 
+		const auto [s, c] = cla::sincos(theta);
+
 		mat.data[0][0] = (T)1.0f;
-		mat.data[1][1] = (T)std::cosf(theta);
-		mat.data[1][2] = (T)std::sinf(theta);
-		mat.data[2][1] = (T)-std::sinf(theta);
-		mat.data[2][2] = (T)std::cosf(theta);
+		mat.data[1][1] = (T)c;
+		mat.data[1][2] = (T)s;
+		mat.data[2][1] = (T)-s;
+		mat.data[2][2] = (T)c;
 		mat.data[3][3] = (T)1.0f;
 
 		return mat;
@@ -105,11 +345,13 @@ export namespace cla
 			}
 		}
 
-		mat.data[0][0] = (T)std::cosf(theta);
+		const auto [s, c] = cla::sincos(theta);
+
+		mat.data[0][0] = (T)c;
 		mat.data[1][1] = (T)1.0f;
-		mat.data[0][2] = (T)std::sinf(theta);
-		mat.data[2][0] = (T)-std::sinf(theta);
-		mat.data[2][2] = (T)std::cosf(theta);
+		mat.data[0][2] = (T)s;
+		mat.data[2][0] = (T)-s;
+		mat.data[2][2] = (T)c;
 		mat.data[3][3] = (T)1.0f;
 
 		return mat;
@@ -128,10 +370,12 @@ export namespace cla
 			}
 		}
 
-		mat.data[0][0] = (T)std::cosf(theta);
-		mat.data[0][1] = (T)std::sinf(theta);
-		mat.data[1][0] = (T)-std::sinf(theta);
-		mat.data[1][1] = (T)std::cosf(theta);
+		const auto [s, c] = cla::sincos(theta);
+
+		mat.data[0][0] = (T)c;
+		mat.data[0][1] = (T)s;
+		mat.data[1][0] = (T)-s;
+		mat.data[1][1] = (T)c;
 		mat.data[2][2] = (T)1.0f;
 		mat.data[3][3] = (T)1.0f;
 
@@ -151,11 +395,11 @@ export namespace cla
 	}
 
 	template<typename T = float>
-	const auto projection(const T& fov, const T& aspectRatio, const T& near, const T& far) noexcept
+	constexpr auto projection(const T& fov, const T& aspectRatio, const T& near, const T& far) noexcept
 	{
 		cla::matrix<T, 4> mat;
 
-		T fovRad = (T)(1.0f / std::tanf(fov * 0.5f / 180.0f * 3.14159f));
+		T fovRad = (T)((T)1.0f / cla::tan(fov * (T)0.5f / (T)180.0f * (T)3.14159f));
 
 		for (auto i = 0; i < 4; ++i)
 		{
@@ -192,6 +436,193 @@ export namespace cla
 		};
 	}
 
+	//block-wise 2x2 adjugate inverse of a float4x4; returns { inverse, determinant }
+	inline auto inverse_general_simd(const cla::matrix<float, 4>& m) noexcept
+	{
+		const __m128 r0 = _mm_loadu_ps(m.data[0].data());
+		const __m128 r1 = _mm_loadu_ps(m.data[1].data());
+		const __m128 r2 = _mm_loadu_ps(m.data[2].data());
+		const __m128 r3 = _mm_loadu_ps(m.data[3].data());
+
+		//2x2 helpers on row-major sub-matrices packed as (m00, m01, m10, m11)
+		const auto mat2Mul = [](__m128 a, __m128 b)
+		{
+			return _mm_add_ps(_mm_mul_ps(a, _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 3, 0))), _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 2, 1, 2))));
+		};
+
+		const auto mat2AdjMul = [](__m128 a, __m128 b)
+		{
+			return _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 3, 3)), b), _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 1, 1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 0, 3, 2))));
+		};
+
+		const auto mat2MulAdj = [](__m128 a, __m128 b)
+		{
+			return _mm_sub_ps(_mm_mul_ps(a, _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 3, 0, 3))), _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 2, 1, 2))));
+		};
+
+		const __m128 a = _mm_movelh_ps(r0, r1), b = _mm_movehl_ps(r1, r0);
+		const __m128 c = _mm_movelh_ps(r2, r3), d = _mm_movehl_ps(r3, r2);
+
+		//determinants of the four blocks as (|a|, |b|, |c|, |d|)
+		const __m128 detSub = _mm_sub_ps(
+			_mm_mul_ps(_mm_shuffle_ps(r0, r2, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(r1, r3, _MM_SHUFFLE(3, 1, 3, 1))),
+			_mm_mul_ps(_mm_shuffle_ps(r0, r2, _MM_SHUFFLE(3, 1, 3, 1)), _mm_shuffle_ps(r1, r3, _MM_SHUFFLE(2, 0, 2, 0))));
+
+		const __m128 detA = _mm_shuffle_ps(detSub, detSub, _MM_SHUFFLE(0, 0, 0, 0));
+		const __m128 detB = _mm_shuffle_ps(detSub, detSub, _MM_SHUFFLE(1, 1, 1, 1));
+		const __m128 detC = _mm_shuffle_ps(detSub, detSub, _MM_SHUFFLE(2, 2, 2, 2));
+		const __m128 detD = _mm_shuffle_ps(detSub, detSub, _MM_SHUFFLE(3, 3, 3, 3));
+
+		const __m128 dc = mat2AdjMul(d, c);
+		const __m128 ab = mat2AdjMul(a, b);
+
+		__m128 x = _mm_sub_ps(_mm_mul_ps(detD, a), mat2Mul(b, dc));
+		__m128 w = _mm_sub_ps(_mm_mul_ps(detA, d), mat2Mul(c, ab));
+		__m128 y = _mm_sub_ps(_mm_mul_ps(detB, c), mat2MulAdj(d, ab));
+		__m128 z = _mm_sub_ps(_mm_mul_ps(detC, b), mat2MulAdj(a, dc));
+
+		//|m| = |a||d| + |b||c| - tr((a#b)(d#c))
+		__m128 tr = _mm_mul_ps(ab, _mm_shuffle_ps(dc, dc, _MM_SHUFFLE(3, 1, 2, 0)));
+		tr = _mm_add_ps(tr, _mm_shuffle_ps(tr, tr, _MM_SHUFFLE(2, 3, 0, 1)));
+		tr = _mm_add_ps(tr, _mm_shuffle_ps(tr, tr, _MM_SHUFFLE(1, 0, 3, 2)));
+
+		const __m128 detM = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(detA, detD), _mm_mul_ps(detB, detC)), tr);
+
+		const __m128 rDetM = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), detM);
+
+		x = _mm_mul_ps(x, rDetM);
+		y = _mm_mul_ps(y, rDetM);
+		z = _mm_mul_ps(z, rDetM);
+		w = _mm_mul_ps(w, rDetM);
+
+		cla::matrix<float, 4> mat;
+
+		_mm_storeu_ps(mat.data[0].data(), _mm_shuffle_ps(x, y, _MM_SHUFFLE(1, 3, 1, 3)));
+		_mm_storeu_ps(mat.data[1].data(), _mm_shuffle_ps(x, y, _MM_SHUFFLE(0, 2, 0, 2)));
+		_mm_storeu_ps(mat.data[2].data(), _mm_shuffle_ps(z, w, _MM_SHUFFLE(1, 3, 1, 3)));
+		_mm_storeu_ps(mat.data[3].data(), _mm_shuffle_ps(z, w, _MM_SHUFFLE(0, 2, 0, 2)));
+
+		return std::pair{ mat, _mm_cvtss_f32(detM) };
+	}
+
+	//cofactor expansion shared by the scalar inverses and the batched lane kernels; a and out only need [i][j] access
+	template<typename A, typename B>
+	constexpr auto inverse_cofactor4(const A& a, B& out) noexcept
+	{
+		using V = std::remove_cvref_t<decltype(a[0][0])>;
+
+		const V s0 = a[0][0] * a[1][1] - a[1][0] * a[0][1];
+		const V s1 = a[0][0] * a[1][2] - a[1][0] * a[0][2];
+		const V s2 = a[0][0] * a[1][3] - a[1][0] * a[0][3];
+		const V s3 = a[0][1] * a[1][2] - a[1][1] * a[0][2];
+		const V s4 = a[0][1] * a[1][3] - a[1][1] * a[0][3];
+		const V s5 = a[0][2] * a[1][3] - a[1][2] * a[0][3];
+
+		const V c5 = a[2][2] * a[3][3] - a[3][2] * a[2][3];
+		const V c4 = a[2][1] * a[3][3] - a[3][1] * a[2][3];
+		const V c3 = a[2][1] * a[3][2] - a[3][1] * a[2][2];
+		const V c2 = a[2][0] * a[3][3] - a[3][0] * a[2][3];
+		const V c1 = a[2][0] * a[3][2] - a[3][0] * a[2][2];
+		const V c0 = a[2][0] * a[3][1] - a[3][0] * a[2][1];
+
+		const V det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+		const V invDet = V(1.0f) / det;
+
+		out[0][0] = (a[1][1] * c5 - a[1][2] * c4 + a[1][3] * c3) * invDet;
+		out[0][1] = (-a[0][1] * c5 + a[0][2] * c4 - a[0][3] * c3) * invDet;
+		out[0][2] = (a[3][1] * s5 - a[3][2] * s4 + a[3][3] * s3) * invDet;
+		out[0][3] = (-a[2][1] * s5 + a[2][2] * s4 - a[2][3] * s3) * invDet;
+
+		out[1][0] = (-a[1][0] * c5 + a[1][2] * c2 - a[1][3] * c1) * invDet;
+		out[1][1] = (a[0][0] * c5 - a[0][2] * c2 + a[0][3] * c1) * invDet;
+		out[1][2] = (-a[3][0] * s5 + a[3][2] * s2 - a[3][3] * s1) * invDet;
+		out[1][3] = (a[2][0] * s5 - a[2][2] * s2 + a[2][3] * s1) * invDet;
+
+		out[2][0] = (a[1][0] * c4 - a[1][1] * c2 + a[1][3] * c0) * invDet;
+		out[2][1] = (-a[0][0] * c4 + a[0][1] * c2 - a[0][3] * c0) * invDet;
+		out[2][2] = (a[3][0] * s4 - a[3][1] * s2 + a[3][3] * s0) * invDet;
+		out[2][3] = (-a[2][0] * s4 + a[2][1] * s2 - a[2][3] * s0) * invDet;
+
+		out[3][0] = (-a[1][0] * c3 + a[1][1] * c1 - a[1][2] * c0) * invDet;
+		out[3][1] = (a[0][0] * c3 - a[0][1] * c1 + a[0][2] * c0) * invDet;
+		out[3][2] = (-a[3][0] * s3 + a[3][1] * s1 - a[3][2] * s0) * invDet;
+		out[3][3] = (a[2][0] * s3 - a[2][1] * s1 + a[2][2] * s0) * invDet;
+
+		return det;
+	}
+
+	template<typename A, typename B>
+	constexpr auto inverse_cofactor3(const A& a, B& out) noexcept
+	{
+		using V = std::remove_cvref_t<decltype(a[0][0])>;
+
+		const V c0 = a[1][1] * a[2][2] - a[1][2] * a[2][1];
+		const V c1 = a[1][2] * a[2][0] - a[1][0] * a[2][2];
+		const V c2 = a[1][0] * a[2][1] - a[1][1] * a[2][0];
+
+		const V det = a[0][0] * c0 + a[0][1] * c1 + a[0][2] * c2;
+		const V invDet = V(1.0f) / det;
+
+		out[0][0] = c0 * invDet;
+		out[0][1] = (a[0][2] * a[2][1] - a[0][1] * a[2][2]) * invDet;
+		out[0][2] = (a[0][1] * a[1][2] - a[0][2] * a[1][1]) * invDet;
+
+		out[1][0] = c1 * invDet;
+		out[1][1] = (a[0][0] * a[2][2] - a[0][2] * a[2][0]) * invDet;
+		out[1][2] = (a[0][2] * a[1][0] - a[0][0] * a[1][2]) * invDet;
+
+		out[2][0] = c2 * invDet;
+		out[2][1] = (a[0][1] * a[2][0] - a[0][0] * a[2][1]) * invDet;
+		out[2][2] = (a[0][0] * a[1][1] - a[0][1] * a[1][0]) * invDet;
+
+		return det;
+	}
+
+	//full inverse by cofactor expansion; returns { inverse, determinant }, a zero determinant leaves the inverse inf/nan
+	template<typename T = float>
+	constexpr auto inverse_general(const cla::matrix<T, 4>& m) noexcept
+	{
+		if constexpr (std::is_same_v<T, float>)
+		{
+			if (!std::is_constant_evaluated()) return cla::inverse_general_simd(m);
+		}
+
+		cla::matrix<T, 4> mat;
+
+		const T det = cla::inverse_cofactor4(m.data, mat.data);
+
+		return std::pair{ mat, det };
+	}
+
+	template<typename T = float>
+	constexpr auto inverse_general(const cla::matrix<T, 3>& m) noexcept
+	{
+		cla::matrix<T, 3> mat;
+
+		const T det = cla::inverse_cofactor3(m.data, mat.data);
+
+		return std::pair{ mat, det };
+	}
+
+	//inverts min(in.size(), out.size()) contiguous matrices; determinants are written to dets when it is large enough
+	template<typename T = float>
+	constexpr auto inverse_general(std::span<const cla::matrix<std::type_identity_t<T>, 4>> in, std::span<cla::matrix<std::type_identity_t<T>, 4>> out, std::span<std::type_identity_t<T>> dets = {}) noexcept
+	{
+		const auto count = std::min(in.size(), out.size());
+
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			const auto [mat, det] = cla::inverse_general<T>(in[i]);
+
+			out[i] = mat;
+
+			if (i < dets.size()) dets[i] = det;
+		}
+
+		return out.first(count);
+	}
+
+	//inverse for rigid transforms only (orthonormal rotation plus translation); see inverse_general for anything else
 	template<typename T = float>
 	constexpr auto inverse(const cla::matrix<T, 4>& m) noexcept
 	{
@@ -237,8 +668,102 @@ export namespace cla
 		return matrix;
 	}
 
-	template<typename T = float, std::size_t S>
-	constexpr auto operator*(const cla::matrix<T, S>& mat1, const cla::matrix<T, S>& mat2) noexcept
+	//linear parts multiply (27 mul) and the first translation is carried through the second transform (9 mul)
+	template<typename T = float>
+	constexpr auto compose(const cla::affine3x4<T>& aff1, const cla::affine3x4<T>& aff2) noexcept
+	{
+		cla::affine3x4<T> aff;
+
+		for (auto i = 0; i < 4; ++i)
+		{
+			for (auto j = 0; j < 3; ++j)
+			{
+				aff.data[i][j] = aff1.data[i][0] * aff2.data[0][j] + aff1.data[i][1] * aff2.data[1][j] + aff1.data[i][2] * aff2.data[2][j];
+			}
+		}
+
+		aff.data[3][0] += aff2.data[3][0];
+		aff.data[3][1] += aff2.data[3][1];
+		aff.data[3][2] += aff2.data[3][2];
+
+		return aff;
+	}
+
+	//exact inverse of the linear part by cofactors, translation mapped through it; a singular linear part yields inf/nan
+	template<typename T = float>
+	constexpr auto inverse(const cla::affine3x4<T>& a) noexcept
+	{
+		cla::affine3x4<T> aff;
+
+		const auto& m = a.data;
+
+		aff.data[0][0] = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+		aff.data[0][1] = m[0][2] * m[2][1] - m[0][1] * m[2][2];
+		aff.data[0][2] = m[0][1] * m[1][2] - m[0][2] * m[1][1];
+		aff.data[1][0] = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+		aff.data[1][1] = m[0][0] * m[2][2] - m[0][2] * m[2][0];
+		aff.data[1][2] = m[0][2] * m[1][0] - m[0][0] * m[1][2];
+		aff.data[2][0] = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+		aff.data[2][1] = m[0][1] * m[2][0] - m[0][0] * m[2][1];
+		aff.data[2][2] = m[0][0] * m[1][1] - m[0][1] * m[1][0];
+
+		const T invDet = (T)1.0f / (m[0][0] * aff.data[0][0] + m[0][1] * aff.data[1][0] + m[0][2] * aff.data[2][0]);
+
+		for (auto i = 0; i < 3; ++i)
+		{
+			for (auto j = 0; j < 3; ++j)
+			{
+				aff.data[i][j] *= invDet;
+			}
+		}
+
+		for (auto j = 0; j < 3; ++j)
+		{
+			aff.data[3][j] = -(m[3][0] * aff.data[0][j] + m[3][1] * aff.data[1][j] + m[3][2] * aff.data[2][j]);
+		}
+
+		return aff;
+	}
+
+	template<typename T = float>
+	constexpr auto to_matrix(const cla::affine3x4<T>& aff) noexcept
+	{
+		return cla::matrix<T, 4>
+		{
+			aff.data[0][0], aff.data[0][1], aff.data[0][2], (T)0.0f,
+			aff.data[1][0], aff.data[1][1], aff.data[1][2], (T)0.0f,
+			aff.data[2][0], aff.data[2][1], aff.data[2][2], (T)0.0f,
+			aff.data[3][0], aff.data[3][1], aff.data[3][2], (T)1.0f
+		};
+	}
+
+	//drops the fourth column; only meaningful for matrices whose fourth column is (0, 0, 0, 1)
+	template<typename T = float>
+	constexpr auto to_affine(const cla::matrix<T, 4>& mat) noexcept
+	{
+		return cla::affine3x4<T>
+		{
+			mat.data[0][0], mat.data[0][1], mat.data[0][2],
+			mat.data[1][0], mat.data[1][1], mat.data[1][2],
+			mat.data[2][0], mat.data[2][1], mat.data[2][2],
+			mat.data[3][0], mat.data[3][1], mat.data[3][2]
+		};
+	}
+
+	template<typename T = float>
+	constexpr auto operator*(const cla::affine3x4<T>& aff1, const cla::affine3x4<T>& aff2) noexcept
+	{
+		return cla::compose(aff1, aff2);
+	}
+
+	template<typename T = float>
+	constexpr auto operator~(const cla::affine3x4<T>& aff) noexcept
+	{
+		return cla::inverse(aff);
+	}
+
+	template<typename T = float, std::size_t R, std::size_t K, std::size_t C>
+	constexpr auto operator*(const cla::matrix<T, R, K>& mat1, const cla::matrix<T, K, C>& mat2) noexcept
 	{
 		return cla::compose(mat1, mat2);
 	}
@@ -0,0 +1,277 @@
+module;
+#include <algorithm>
+#include <array>
+#include <span>
+#include <cmath>
+#include <immintrin.h>
+export module quat;
+
+import stdex;
+import core;
+import trig;
+import vector;
+
+export namespace cla
+{
+	//unit quaternion (x, y, z) + w; rotations follow the right-hand rule about the axis
+	template<typename T = float>
+	struct quat
+	{
+		T x = (T)0.0f, y = (T)0.0f, z = (T)0.0f, w = (T)1.0f;
+	};
+
+	using quatf = quat<float>;
+	using quatd = quat<double>;
+
+	template<typename T = float>
+	constexpr auto from_axis_angle(const cla::v3d_generic<T>& axis, const T& angle) noexcept
+	{
+		const auto [s, c] = cla::sincos(angle * (T)0.5f);
+		const auto n = cla::normalize(axis);
+
+		return cla::quat<T>{ (T)(n.x * s), (T)(n.y * s), (T)(n.z * s), c };
+	}
+
+	template<typename T = float>
+	constexpr auto dot(const cla::quat<T>& q1, const cla::quat<T>& q2) noexcept
+	{
+		return (q1.x * q2.x + q1.y * q2.y + q1.z * q2.z + q1.w * q2.w);
+	}
+
+	template<typename T = float>
+	constexpr auto normalize(const cla::quat<T>& q) noexcept
+	{
+		const T len = std::my_sqrt(cla::dot(q, q));
+
+		return cla::quat<T>{ q.x / len, q.y / len, q.z / len, q.w / len };
+	}
+
+	template<typename T = float>
+	constexpr auto conjugate(const cla::quat<T>& q) noexcept
+	{
+		return cla::quat<T>{ -q.x, -q.y, -q.z, q.w };
+	}
+
+	//raw Hamilton product q1 q2, which rotates by q2 first and q1 second
+	template<typename T = float>
+	constexpr auto hamilton(const cla::quat<T>& q1, const cla::quat<T>& q2) noexcept
+	{
+		return cla::quat<T>
+		{
+			q1.w * q2.x + q1.x * q2.w + q1.y * q2.z - q1.z * q2.y,
+			q1.w * q2.y - q1.x * q2.z + q1.y * q2.w + q1.z * q2.x,
+			q1.w * q2.z + q1.x * q2.y - q1.y * q2.x + q1.z * q2.w,
+			q1.w * q2.w - q1.x * q2.x - q1.y * q2.y - q1.z * q2.z
+		};
+	}
+
+	//same order as matrix compose: q1 is applied first, so to_matrix(q1 * q2) == to_matrix(q1) * to_matrix(q2)
+	template<typename T = float>
+	constexpr auto compose(const cla::quat<T>& q1, const cla::quat<T>& q2) noexcept
+	{
+		return cla::hamilton(q2, q1);
+	}
+
+	//v + 2w(u x v) + 2u x (u x v), 15 mul against 27 for the full sandwich product
+	template<typename T = float>
+	constexpr auto rotate(const cla::quat<T>& q, const cla::v3d_generic<T>& vec) noexcept
+	{
+		const cla::v3d_generic<T> u(q.x, q.y, q.z);
+
+		auto t = cla::cross(u, vec);
+		t *= (T)2.0f;
+
+		auto outVec = cla::cross(u, t);
+		outVec.x += vec.x + q.w * t.x;
+		outVec.y += vec.y + q.w * t.y;
+		outVec.z += vec.z + q.w * t.z;
+
+		return outVec;
+	}
+
+	//row-vector matrix, so vec * to_matrix(q) == rotate(q, vec); matches rotationX/rotationZ for the same angle,
+	//while rotationY(theta) turns the other way and equals the quaternion for -theta
+	template<typename T = float>
+	constexpr auto to_matrix(const cla::quat<T>& q) noexcept
+	{
+		const T xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+		const T xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+		const T wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+		return cla::matrix<T, 4>
+		{
+			(T)1.0f - (T)2.0f * (yy + zz), (T)2.0f * (xy + wz), (T)2.0f * (xz - wy), (T)0.0f,
+			(T)2.0f * (xy - wz), (T)1.0f - (T)2.0f * (xx + zz), (T)2.0f * (yz + wx), (T)0.0f,
+			(T)2.0f * (xz + wy), (T)2.0f * (yz - wx), (T)1.0f - (T)2.0f * (xx + yy), (T)0.0f,
+			(T)0.0f, (T)0.0f, (T)0.0f, (T)1.0f
+		};
+	}
+
+	//rotation part of mat by Shepperd's method; translation and any scale are ignored
+	template<typename T = float>
+	constexpr auto to_quat(const cla::matrix<T, 4>& mat) noexcept
+	{
+		const auto& m = mat.data;
+		const T trace = m[0][0] + m[1][1] + m[2][2];
+
+		cla::quat<T> q;
+
+		if (trace > (T)0.0f)
+		{
+			const T s = std::my_sqrt(trace + (T)1.0f) * (T)2.0f;
+			q = { (m[1][2] - m[2][1]) / s, (m[2][0] - m[0][2]) / s, (m[0][1] - m[1][0]) / s, (T)0.25f * s };
+		}
+
+		else if (m[0][0] > m[1][1] && m[0][0] > m[2][2])
+		{
+			const T s = std::my_sqrt((T)1.0f + m[0][0] - m[1][1] - m[2][2]) * (T)2.0f;
+			q = { (T)0.25f * s, (m[0][1] + m[1][0]) / s, (m[0][2] + m[2][0]) / s, (m[1][2] - m[2][1]) / s };
+		}
+
+		else if (m[1][1] > m[2][2])
+		{
+			const T s = std::my_sqrt((T)1.0f + m[1][1] - m[0][0] - m[2][2]) * (T)2.0f;
+			q = { (m[0][1] + m[1][0]) / s, (T)0.25f * s, (m[1][2] + m[2][1]) / s, (m[2][0] - m[0][2]) / s };
+		}
+
+		else
+		{
+			const T s = std::my_sqrt((T)1.0f + m[2][2] - m[0][0] - m[1][1]) * (T)2.0f;
+			q = { (m[0][2] + m[2][0]) / s, (m[1][2] + m[2][1]) / s, (T)0.25f * s, (m[0][1] - m[1][0]) / s };
+		}
+
+		return cla::normalize(q);
+	}
+
+	//normalized linear interpolation along the shorter arc
+	template<typename T = float>
+	constexpr auto nlerp(const cla::quat<T>& q1, const cla::quat<T>& q2, const T& t) noexcept
+	{
+		const T sign = (cla::dot(q1, q2) < (T)0.0f) ? (T)-1.0f : (T)1.0f;
+		const T d = (T)1.0f - t;
+
+		return cla::normalize(cla::quat<T>{ d * q1.x + sign * t * q2.x, d * q1.y + sign * t * q2.y, d * q1.z + sign * t * q2.z, d * q1.w + sign * t * q2.w });
+	}
+
+	//Eberly's trig-free slerp: sin(t theta) / sin(theta) is the series t * prod(1 + b_i) nested in cos(theta) - 1, with
+	//b_i = (t^2 - i^2) / (i (2i + 1)) * (cos(theta) - 1); sixteen terms with the last one scaled by slerp_mu keep the
+	//absolute error below 3.1e-8 over the whole shorter arc (mu refit by minimax search for this term count)
+	constexpr auto slerp_terms = 16;
+	constexpr double slerp_mu = 1.916669;
+
+	//u_i = 1 / (i (2i + 1)) and v_i = i / (2i + 1), stored from i = 1 at index 0
+	constexpr auto slerp_uv = []()
+	{
+		std::array<std::array<double, 2>, cla::slerp_terms> uv{};
+
+		for (auto i = 1; i <= cla::slerp_terms; ++i)
+		{
+			const double scale = (i == cla::slerp_terms) ? cla::slerp_mu : 1.0;
+
+			uv[i - 1] = { scale / (i * (2.0 * i + 1.0)), scale * i / (2.0 * i + 1.0) };
+		}
+
+		return uv;
+	}();
+
+	template<typename T = float>
+	constexpr auto slerp_coefficient(const T& t, const T& xm1) noexcept
+	{
+		const T t2 = t * t;
+
+		T c = (T)1.0f;
+
+		for (auto i = cla::slerp_terms - 1; i >= 0; --i)
+		{
+			c = (T)1.0f + ((T)cla::slerp_uv[i][0] * t2 - (T)cla::slerp_uv[i][1]) * xm1 * c;
+		}
+
+		return t * c;
+	}
+
+	template<typename T = float>
+	constexpr auto slerp(const cla::quat<T>& q1, const cla::quat<T>& q2, const T& t) noexcept
+	{
+		T x = cla::dot(q1, q2);
+		const T sign = (x < (T)0.0f) ? (T)-1.0f : (T)1.0f;
+		x *= sign;
+
+		const T ct = sign * cla::slerp_coefficient(t, x - (T)1.0f);
+		const T cd = cla::slerp_coefficient((T)1.0f - t, x - (T)1.0f);
+
+		return cla::quat<T>{ cd * q1.x + ct * q2.x, cd * q1.y + ct * q2.y, cd * q1.z + ct * q2.z, cd * q1.w + ct * q2.w };
+	}
+
+	//batched slerp over min of all span sizes; coefficients for eight pairs are evaluated per AVX register
+	inline auto slerp(std::span<const cla::quatf> q1, std::span<const cla::quatf> q2, std::span<const float> t, std::span<cla::quatf> out) noexcept
+	{
+		const auto count = std::min({ q1.size(), q2.size(), t.size(), out.size() });
+
+		std::size_t i = 0;
+
+#if defined(__AVX__)
+		alignas(32) float dots[8], ct[8], cd[8];
+
+		const auto coefficient = [](__m256 tv, __m256 xm1)
+		{
+			const __m256 t2 = _mm256_mul_ps(tv, tv);
+
+			__m256 c = _mm256_set1_ps(1.0f);
+
+			for (auto k = cla::slerp_terms - 1; k >= 0; --k)
+			{
+				const __m256 u = _mm256_set1_ps((float)cla::slerp_uv[k][0]);
+				const __m256 v = _mm256_set1_ps((float)cla::slerp_uv[k][1]);
+
+				c = _mm256_add_ps(_mm256_set1_ps(1.0f), _mm256_mul_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(u, t2), v), xm1), c));
+			}
+
+			return _mm256_mul_ps(tv, c);
+		};
+
+		for (; i + 8 <= count; i += 8)
+		{
+			for (auto l = 0; l < 8; ++l)
+			{
+				dots[l] = cla::dot(q1[i + l], q2[i + l]);
+			}
+
+			const __m256 x = _mm256_loadu_ps(dots);
+			const __m256 signBit = _mm256_and_ps(x, _mm256_set1_ps(-0.0f));
+			const __m256 xm1 = _mm256_sub_ps(_mm256_xor_ps(x, signBit), _mm256_set1_ps(1.0f));
+
+			const __m256 tv = _mm256_loadu_ps(&t[i]);
+
+			_mm256_store_ps(ct, _mm256_xor_ps(coefficient(tv, xm1), signBit));
+			_mm256_store_ps(cd, coefficient(_mm256_sub_ps(_mm256_set1_ps(1.0f), tv), xm1));
+
+			for (auto l = 0; l < 8; ++l)
+			{
+				const __m128 a = _mm_loadu_ps(&q1[i + l].x);
+				const __m128 b = _mm_loadu_ps(&q2[i + l].x);
+
+				_mm_storeu_ps(&out[i + l].x, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(cd[l]), a), _mm_mul_ps(_mm_set1_ps(ct[l]), b)));
+			}
+		}
+#endif
+
+		for (; i < count; ++i)
+		{
+			out[i] = cla::slerp(q1[i], q2[i], t[i]);
+		}
+
+		return out.first(count);
+	}
+
+	template<typename T = float>
+	constexpr auto operator*(const cla::quat<T>& q1, const cla::quat<T>& q2) noexcept
+	{
+		return cla::compose(q1, q2);
+	}
+
+	template<typename T = float>
+	constexpr auto operator*(const cla::v3d_generic<T>& vec, const cla::quat<T>& q) noexcept
+	{
+		return cla::rotate(q, vec);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,361 @@
+module;
+#include <functional>
+#include <type_traits>
+#include <algorithm>
+#include <cstdint>
+#include <immintrin.h>
+export module simd;
+
+import stdex;
+import core;
+
+export namespace cla
+{
+	//four lanes in one register: __m128 for float, __m128i for int32_t, __m256d for double with AVX; other element types
+	//fall back to plain lane loops. Same member layout as v3d_generic<T>, so converting either way is a single 16/32 byte copy
+	template<typename T = float>
+	struct alignas(4 * sizeof(T) < 16 ? 16 : 4 * sizeof(T)) simd_vec4
+	{
+		T x = (T)0.0f, y = (T)0.0f, z = (T)0.0f, w = (T)1.0f;
+
+		constexpr simd_vec4() noexcept = default;
+		constexpr simd_vec4(T _x, T _y, T _z, T _w = (T)1.0f) noexcept : x(_x), y(_y), z(_z), w(_w) {}
+		constexpr simd_vec4(const cla::v3d_generic<T>& v) noexcept : x(v.x), y(v.y), z(v.z), w(v.w) {}
+
+		constexpr operator cla::v3d_generic<T>() const noexcept
+		{
+			cla::v3d_generic<T> vec(x, y, z);
+			vec.w = w;
+
+			return vec;
+		}
+
+		constexpr T& operator[](std::size_t i) noexcept { return (i == 0) ? x : (i == 1) ? y : (i == 2) ? z : w; }
+		constexpr const T& operator[](std::size_t i) const noexcept { return (i == 0) ? x : (i == 1) ? y : (i == 2) ? z : w; }
+	};
+
+	using sf4 = simd_vec4<float>;
+	using sd4 = simd_vec4<double>;
+	using si4 = simd_vec4<int32_t>;
+
+	//register-wide binary op for the element types that have one; returns false when the caller must fall back to lanes.
+	//with KeepW the w lane of vec1 is blended back over the result
+	template<typename binaryop, bool KeepW, typename T>
+	inline bool simd_binary(const cla::simd_vec4<T>& vec1, const cla::simd_vec4<T>& vec2, cla::simd_vec4<T>& out) noexcept
+	{
+		if constexpr (std::is_same_v<T, float>)
+		{
+			const __m128 a = _mm_load_ps(&vec1.x), b = _mm_load_ps(&vec2.x);
+
+			__m128 r;
+
+			if constexpr (std::is_same_v<binaryop, std::plus<>>) r = _mm_add_ps(a, b);
+			else if constexpr (std::is_same_v<binaryop, std::minus<>>) r = _mm_sub_ps(a, b);
+			else if constexpr (std::is_same_v<binaryop, std::multiplies<>>) r = _mm_mul_ps(a, b);
+			else if constexpr (std::is_same_v<binaryop, std::divides<>>) r = _mm_div_ps(a, b);
+			else return false;
+
+			if constexpr (KeepW)
+			{
+				const __m128 wMask = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+				r = _mm_or_ps(_mm_andnot_ps(wMask, r), _mm_and_ps(wMask, a));
+			}
+
+			_mm_store_ps(&out.x, r);
+
+			return true;
+		}
+#if defined(__AVX__)
+		else if constexpr (std::is_same_v<T, double>)
+		{
+			const __m256d a = _mm256_load_pd(&vec1.x), b = _mm256_load_pd(&vec2.x);
+
+			__m256d r;
+
+			if constexpr (std::is_same_v<binaryop, std::plus<>>) r = _mm256_add_pd(a, b);
+			else if constexpr (std::is_same_v<binaryop, std::minus<>>) r = _mm256_sub_pd(a, b);
+			else if constexpr (std::is_same_v<binaryop, std::multiplies<>>) r = _mm256_mul_pd(a, b);
+			else if constexpr (std::is_same_v<binaryop, std::divides<>>) r = _mm256_div_pd(a, b);
+			else return false;
+
+			if constexpr (KeepW) r = _mm256_blend_pd(r, a, 0x8);
+
+			_mm256_store_pd(&out.x, r);
+
+			return true;
+		}
+#endif
+		else if constexpr (std::is_same_v<T, int32_t>)
+		{
+			const __m128i a = _mm_load_si128(reinterpret_cast<const __m128i*>(&vec1.x)), b = _mm_load_si128(reinterpret_cast<const __m128i*>(&vec2.x));
+
+			__m128i r;
+
+			if constexpr (std::is_same_v<binaryop, std::plus<>>) r = _mm_add_epi32(a, b);
+			else if constexpr (std::is_same_v<binaryop, std::minus<>>) r = _mm_sub_epi32(a, b);
+#if defined(__SSE4_1__) || defined(__AVX__)
+			else if constexpr (std::is_same_v<binaryop, std::multiplies<>>) r = _mm_mullo_epi32(a, b);
+#endif
+			else return false;
+
+			if constexpr (KeepW)
+			{
+				const __m128i wMask = _mm_set_epi32(-1, 0, 0, 0);
+				r = _mm_or_si128(_mm_andnot_si128(wMask, r), _mm_and_si128(wMask, a));
+			}
+
+			_mm_store_si128(reinterpret_cast<__m128i*>(&out.x), r);
+
+			return true;
+		}
+		else return false;
+	}
+
+	//element-wise vec1 op vec2 on x, y and z; w is kept from vec1 so points stay points, as with v3d_generic
+	template<typename binaryop = std::multiplies<void>, typename T = float>
+	constexpr auto reduce(const cla::simd_vec4<T>& vec1, const cla::simd_vec4<T>& vec2) noexcept
+	{
+		cla::simd_vec4<T> outVec;
+
+		if (!std::is_constant_evaluated())
+		{
+			if (cla::simd_binary<binaryop, true>(vec1, vec2, outVec)) return outVec;
+		}
+
+		outVec.x = binaryop{}(vec1.x, vec2.x);
+		outVec.y = binaryop{}(vec1.y, vec2.y);
+		outVec.z = binaryop{}(vec1.z, vec2.z);
+		outVec.w = vec1.w;
+
+		return outVec;
+	}
+
+	//element-wise vec1 op vec2 on all four lanes, w included, for callers that want full homogeneous arithmetic
+	template<typename binaryop = std::multiplies<void>, typename T = float>
+	constexpr auto reduce4(const cla::simd_vec4<T>& vec1, const cla::simd_vec4<T>& vec2) noexcept
+	{
+		cla::simd_vec4<T> outVec;
+
+		if (!std::is_constant_evaluated())
+		{
+			if (cla::simd_binary<binaryop, false>(vec1, vec2, outVec)) return outVec;
+		}
+
+		outVec.x = binaryop{}(vec1.x, vec2.x);
+		outVec.y = binaryop{}(vec1.y, vec2.y);
+		outVec.z = binaryop{}(vec1.z, vec2.z);
+		outVec.w = binaryop{}(vec1.w, vec2.w);
+
+		return outVec;
+	}
+
+	//vec op operand on x, y and z, w kept
+	template<typename binaryop = std::multiplies<void>, typename T = float>
+	constexpr auto apply(const cla::simd_vec4<T>& vec, const T& operand) noexcept
+	{
+		return cla::reduce<binaryop>(vec, cla::simd_vec4<T>(operand, operand, operand, operand));
+	}
+
+	//vec op operand on all four lanes
+	template<typename binaryop = std::multiplies<void>, typename T = float>
+	constexpr auto apply4(const cla::simd_vec4<T>& vec, const T& operand) noexcept
+	{
+		return cla::reduce4<binaryop>(vec, cla::simd_vec4<T>(operand, operand, operand, operand));
+	}
+
+	//horizontal sum of x, y and z; w is left out to match cla::sum on v3d_generic
+	template<typename T = float>
+	constexpr auto sum(const cla::simd_vec4<T>& vec) noexcept
+	{
+		return (vec.x + vec.y + vec.z);
+	}
+
+	template<typename T = float>
+	constexpr auto dot(const cla::simd_vec4<T>& vec1, const cla::simd_vec4<T>& vec2) noexcept
+	{
+		return cla::sum(cla::reduce<std::multiplies<>>(vec1, vec2));
+	}
+
+	template<typename T = float>
+	constexpr auto length2(const cla::simd_vec4<T>& vec) noexcept
+	{
+		return cla::dot(vec, vec);
+	}
+
+	template<typename T = float>
+	constexpr auto length(const cla::simd_vec4<T>& vec) noexcept
+	{
+		return std::my_sqrt(cla::length2(vec));
+	}
+
+	//scales x, y and z to unit length and keeps w
+	template<typename T = float>
+	constexpr auto normalize(const cla::simd_vec4<T>& vec) noexcept
+	{
+		const T len = cla::length(vec);
+
+		return cla::apply<std::divides<>>(vec, len);
+	}
+
+	//negates x, y and z and keeps w, as cla::inverse does for v3d_generic
+	template<typename T = float>
+	constexpr auto inverse(const cla::simd_vec4<T>& vec) noexcept
+	{
+		return cla::apply<std::multiplies<>>(vec, (T)-1);
+	}
+
+	//cross of the xyz parts with vec1's w carried over, as cla::cross does for v3d_generic
+	template<typename T = float>
+	constexpr auto cross(const cla::simd_vec4<T>& vec1, const cla::simd_vec4<T>& vec2) noexcept
+	{
+		if constexpr (std::is_same_v<T, float>)
+		{
+			if (!std::is_constant_evaluated())
+			{
+				const __m128 a = _mm_load_ps(&vec1.x), b = _mm_load_ps(&vec2.x);
+
+				//a.yzx * b.zxy - a.zxy * b.yzx, computed as (a * b.yzx - a.yzx * b).yzx
+				const __m128 ayzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1)), byzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+				const __m128 c = _mm_sub_ps(_mm_mul_ps(a, byzx), _mm_mul_ps(ayzx, b));
+
+				cla::simd_vec4<T> outVec;
+				_mm_store_ps(&outVec.x, _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1)));
+				outVec.w = vec1.w;
+
+				return outVec;
+			}
+		}
+
+		return cla::simd_vec4<T>
+		(
+			(vec1.y * vec2.z) - (vec1.z * vec2.y),
+			(vec1.z * vec2.x) - (vec1.x * vec2.z),
+			(vec1.x * vec2.y) - (vec1.y * vec2.x),
+			vec1.w
+		);
+	}
+
+	template<typename T = float>
+	constexpr auto min(const cla::simd_vec4<T>& vec1, const cla::simd_vec4<T>& vec2) noexcept
+	{
+		if constexpr (std::is_same_v<T, float>)
+		{
+			if (!std::is_constant_evaluated())
+			{
+				cla::simd_vec4<T> outVec;
+				_mm_store_ps(&outVec.x, _mm_min_ps(_mm_load_ps(&vec1.x), _mm_load_ps(&vec2.x)));
+
+				return outVec;
+			}
+		}
+
+		return cla::simd_vec4<T>(std::min(vec1.x, vec2.x), std::min(vec1.y, vec2.y), std::min(vec1.z, vec2.z), std::min(vec1.w, vec2.w));
+	}
+
+	template<typename T = float>
+	constexpr auto max(const cla::simd_vec4<T>& vec1, const cla::simd_vec4<T>& vec2) noexcept
+	{
+		if constexpr (std::is_same_v<T, float>)
+		{
+			if (!std::is_constant_evaluated())
+			{
+				cla::simd_vec4<T> outVec;
+				_mm_store_ps(&outVec.x, _mm_max_ps(_mm_load_ps(&vec1.x), _mm_load_ps(&vec2.x)));
+
+				return outVec;
+			}
+		}
+
+		return cla::simd_vec4<T>(std::max(vec1.x, vec2.x), std::max(vec1.y, vec2.y), std::max(vec1.z, vec2.z), std::max(vec1.w, vec2.w));
+	}
+
+	//full homogeneous row vector times mat; unlike cla::mul on v3d_generic, w is used as stored rather than assumed 1
+	template<typename T = float>
+	constexpr auto mul(const cla::simd_vec4<T>& vec, const cla::matrix<T, 4>& mat) noexcept
+	{
+		if constexpr (std::is_same_v<T, float>)
+		{
+			if (!std::is_constant_evaluated())
+			{
+				const __m128 v = _mm_load_ps(&vec.x);
+
+				__m128 r = _mm_mul_ps(_mm_shuffle_ps(v, v, 0x00), _mm_loadu_ps(mat.data[0].data()));
+				r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(v, v, 0x55), _mm_loadu_ps(mat.data[1].data())));
+				r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(v, v, 0xAA), _mm_loadu_ps(mat.data[2].data())));
+				r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(v, v, 0xFF), _mm_loadu_ps(mat.data[3].data())));
+
+				cla::simd_vec4<T> outVec;
+				_mm_store_ps(&outVec.x, r);
+
+				return outVec;
+			}
+		}
+
+		cla::simd_vec4<T> outVec;
+
+		for (auto j = 0; j < 4; ++j)
+		{
+			outVec[j] = vec.x * mat.data[0][j] + vec.y * mat.data[1][j] + vec.z * mat.data[2][j] + vec.w * mat.data[3][j];
+		}
+
+		return outVec;
+	}
+
+	template<typename T = float>
+	constexpr auto operator+(const cla::simd_vec4<T>& vec1, const cla::simd_vec4<T>& vec2) noexcept { return cla::reduce<std::plus<>>(vec1, vec2); }
+
+	template<typename T = float>
+	constexpr auto operator-(const cla::simd_vec4<T>& vec1, const cla::simd_vec4<T>& vec2) noexcept { return cla::reduce<std::minus<>>(vec1, vec2); }
+
+	template<typename T = float>
+	constexpr auto operator*(const cla::simd_vec4<T>& vec1, const cla::simd_vec4<T>& vec2) noexcept { return cla::reduce<std::multiplies<>>(vec1, vec2); }
+
+	template<typename T = float>
+	constexpr auto operator/(const cla::simd_vec4<T>& vec1, const cla::simd_vec4<T>& vec2) noexcept { return cla::reduce<std::divides<>>(vec1, vec2); }
+
+	template<typename T = float>
+	constexpr auto operator+(const cla::simd_vec4<T>& vec, const std::type_identity_t<T>& operand) noexcept { return cla::apply<std::plus<>>(vec, operand); }
+
+	template<typename T = float>
+	constexpr auto operator-(const cla::simd_vec4<T>& vec, const std::type_identity_t<T>& operand) noexcept { return cla::apply<std::minus<>>(vec, operand); }
+
+	template<typename T = float>
+	constexpr auto operator*(const cla::simd_vec4<T>& vec, const std::type_identity_t<T>& operand) noexcept { return cla::apply<std::multiplies<>>(vec, operand); }
+
+	template<typename T = float>
+	constexpr auto operator/(const cla::simd_vec4<T>& vec, const std::type_identity_t<T>& operand) noexcept { return cla::apply<std::divides<>>(vec, operand); }
+
+	template<typename T = float>
+	constexpr auto operator*(const std::type_identity_t<T>& operand, const cla::simd_vec4<T>& vec) noexcept { return cla::apply<std::multiplies<>>(vec, operand); }
+
+	template<typename T = float>
+	constexpr auto operator-(const cla::simd_vec4<T>& vec) noexcept { return cla::inverse(vec); }
+
+	template<typename T = float>
+	constexpr auto& operator+=(cla::simd_vec4<T>& vec1, const cla::simd_vec4<T>& vec2) noexcept { return vec1 = vec1 + vec2; }
+
+	template<typename T = float>
+	constexpr auto& operator-=(cla::simd_vec4<T>& vec1, const cla::simd_vec4<T>& vec2) noexcept { return vec1 = vec1 - vec2; }
+
+	template<typename T = float>
+	constexpr auto& operator*=(cla::simd_vec4<T>& vec1, const cla::simd_vec4<T>& vec2) noexcept { return vec1 = vec1 * vec2; }
+
+	template<typename T = float>
+	constexpr auto& operator/=(cla::simd_vec4<T>& vec1, const cla::simd_vec4<T>& vec2) noexcept { return vec1 = vec1 / vec2; }
+
+	template<typename T = float>
+	constexpr auto& operator*=(cla::simd_vec4<T>& vec, const std::type_identity_t<T>& operand) noexcept { return vec = vec * operand; }
+
+	template<typename T = float>
+	constexpr auto& operator/=(cla::simd_vec4<T>& vec, const std::type_identity_t<T>& operand) noexcept { return vec = vec / operand; }
+
+	//compares x, y and z like v3d_generic
+	template<typename T = float>
+	constexpr bool operator==(const cla::simd_vec4<T>& vec1, const cla::simd_vec4<T>& vec2) noexcept { return (vec1.x == vec2.x && vec1.y == vec2.y && vec1.z == vec2.z); }
+
+	template<typename T = float>
+	constexpr auto operator*(const cla::simd_vec4<T>& vec, const cla::matrix<T, 4>& mat) noexcept { return cla::mul(vec, mat); }
+
+	template<typename T = float>
+	constexpr auto operator!(const cla::simd_vec4<T>& vec) noexcept { return cla::inverse(vec); }
+}
\ No newline at end of file
@@ -0,0 +1,414 @@
+module;
+#include <algorithm>
+#include <array>
+#include <span>
+#include <utility>
+#include <type_traits>
+#include <cmath>
+#include <immintrin.h>
+export module solve;
+
+import stdex;
+import core;
+import lanes;
+
+export namespace cla
+{
+	//packed LU factors of P A: unit lower triangle below the diagonal, upper triangle on and above it
+	//pivot[i] is the source row of row i; det is zero exactly when a pivot column was all zeros
+	template<typename T = float, std::size_t S = 4>
+	struct lu_result
+	{
+		cla::matrix<T, S> lu;
+		std::array<std::size_t, S> pivot;
+		T det;
+	};
+
+	//Householder factors in JAMA layout: reflector k occupies column k from the diagonal down, rdiag holds the diagonal of R
+	template<typename T = float, std::size_t R = 4, std::size_t C = R>
+	struct qr_result
+	{
+		cla::matrix<T, R, C> qr;
+		std::array<T, C> rdiag;
+	};
+
+	//doolittle elimination with partial pivoting
+	template<typename T = float, std::size_t S = 4>
+	constexpr auto lu(const cla::matrix<T, S>& mat) noexcept
+	{
+		cla::lu_result<T, S> f{ mat, {}, (T)1.0f };
+
+		auto& a = f.lu.data;
+
+		for (std::size_t i = 0; i < S; ++i) f.pivot[i] = i;
+
+		for (std::size_t k = 0; k < S; ++k)
+		{
+			std::size_t p = k;
+
+			for (auto i = k + 1; i < S; ++i)
+			{
+				if (std::my_abs(a[i][k]) > std::my_abs(a[p][k])) p = i;
+			}
+
+			if (p != k)
+			{
+				std::swap(a[p], a[k]);
+				std::swap(f.pivot[p], f.pivot[k]);
+				f.det = -f.det;
+			}
+
+			f.det *= a[k][k];
+
+			if (a[k][k] == (T)0.0f) continue;
+
+			for (auto i = k + 1; i < S; ++i)
+			{
+				const T l = (a[i][k] /= a[k][k]);
+
+				for (auto j = k + 1; j < S; ++j)
+				{
+					a[i][j] -= l * a[k][j];
+				}
+			}
+		}
+
+		return f;
+	}
+
+	template<typename T = float, std::size_t S = 4>
+	constexpr auto lu_solve(const cla::lu_result<T, S>& f, const std::array<T, S>& b) noexcept
+	{
+		const auto& a = f.lu.data;
+
+		std::array<T, S> x;
+
+		for (std::size_t i = 0; i < S; ++i)
+		{
+			T sum = b[f.pivot[i]];
+
+			for (std::size_t j = 0; j < i; ++j) sum -= a[i][j] * x[j];
+
+			x[i] = sum;
+		}
+
+		for (auto i = S; i-- > 0;)
+		{
+			T sum = x[i];
+
+			for (auto j = i + 1; j < S; ++j) sum -= a[i][j] * x[j];
+
+			x[i] = sum / a[i][i];
+		}
+
+		return x;
+	}
+
+	template<typename T = float, std::size_t S = 4>
+	constexpr auto solve(const cla::matrix<T, S>& mat, const std::array<T, S>& b) noexcept
+	{
+		return cla::lu_solve(cla::lu(mat), b);
+	}
+
+	template<typename T = float, std::size_t R = 4, std::size_t C = R>
+	constexpr auto qr(const cla::matrix<T, R, C>& mat) noexcept requires (R >= C)
+	{
+		cla::qr_result<T, R, C> f{ mat, {} };
+
+		auto& a = f.qr.data;
+
+		for (std::size_t k = 0; k < C; ++k)
+		{
+			T norm2 = (T)0.0f;
+
+			for (auto i = k; i < R; ++i) norm2 += a[i][k] * a[i][k];
+
+			T norm = std::my_sqrt(norm2);
+
+			if (norm != (T)0.0f)
+			{
+				if (a[k][k] < (T)0.0f) norm = -norm;
+
+				for (auto i = k; i < R; ++i) a[i][k] /= norm;
+
+				a[k][k] += (T)1.0f;
+
+				for (auto j = k + 1; j < C; ++j)
+				{
+					T s = (T)0.0f;
+
+					for (auto i = k; i < R; ++i) s += a[i][k] * a[i][j];
+
+					s = -s / a[k][k];
+
+					for (auto i = k; i < R; ++i) a[i][j] += s * a[i][k];
+				}
+			}
+
+			f.rdiag[k] = -norm;
+		}
+
+		return f;
+	}
+
+	//least-squares solution of min |A x - b|; a zero in rdiag means A was rank deficient
+	template<typename T = float, std::size_t R = 4, std::size_t C = R>
+	constexpr auto qr_solve(const cla::qr_result<T, R, C>& f, std::array<T, R> b) noexcept
+	{
+		const auto& a = f.qr.data;
+
+		for (std::size_t k = 0; k < C; ++k)
+		{
+			if (a[k][k] == (T)0.0f) continue;
+
+			T s = (T)0.0f;
+
+			for (auto i = k; i < R; ++i) s += a[i][k] * b[i];
+
+			s = -s / a[k][k];
+
+			for (auto i = k; i < R; ++i) b[i] += s * a[i][k];
+		}
+
+		std::array<T, C> x;
+
+		for (auto k = C; k-- > 0;)
+		{
+			T sum = b[k];
+
+			for (auto j = k + 1; j < C; ++j) sum -= a[k][j] * x[j];
+
+			x[k] = sum / f.rdiag[k];
+		}
+
+		return x;
+	}
+
+	//returns { L, spd } with A = L L^T; spd is false when a non-positive pivot shows A is not positive definite
+	template<typename T = float, std::size_t S = 4>
+	constexpr auto cholesky(const cla::matrix<T, S>& mat) noexcept
+	{
+		cla::matrix<T, S> l{};
+
+		for (std::size_t j = 0; j < S; ++j)
+		{
+			T d = mat.data[j][j];
+
+			for (std::size_t k = 0; k < j; ++k) d -= l.data[j][k] * l.data[j][k];
+
+			if (!(d > (T)0.0f)) return std::pair{ l, false };
+
+			l.data[j][j] = std::my_sqrt(d);
+
+			for (auto i = j + 1; i < S; ++i)
+			{
+				T s = mat.data[i][j];
+
+				for (std::size_t k = 0; k < j; ++k) s -= l.data[i][k] * l.data[j][k];
+
+				l.data[i][j] = s / l.data[j][j];
+			}
+		}
+
+		return std::pair{ l, true };
+	}
+
+	//forward and back substitution with the factor L from cla::cholesky, not A itself; the batched cla::cholesky_solve takes A
+	template<typename T = float, std::size_t S = 4>
+	constexpr auto cholesky_substitute(const cla::matrix<T, S>& l, const std::array<T, S>& b) noexcept
+	{
+		std::array<T, S> x;
+
+		for (std::size_t i = 0; i < S; ++i)
+		{
+			T sum = b[i];
+
+			for (std::size_t k = 0; k < i; ++k) sum -= l.data[i][k] * x[k];
+
+			x[i] = sum / l.data[i][i];
+		}
+
+		for (auto i = S; i-- > 0;)
+		{
+			T sum = x[i];
+
+			for (auto k = i + 1; k < S; ++k) sum -= l.data[k][i] * x[k];
+
+			x[i] = sum / l.data[i][i];
+		}
+
+		return x;
+	}
+
+	//partial-pivot LU solve where every arithmetic value is a lane pack; pivots are chosen and rows swapped per lane with blends
+	template<typename P, std::size_t S>
+	inline auto lu_solve_lanes(P (&a)[S][S], P (&b)[S]) noexcept
+	{
+		for (std::size_t k = 0; k < S; ++k)
+		{
+			P best = cla::lane_abs(a[k][k]);
+			P piv = (float)k;
+
+			for (auto i = k + 1; i < S; ++i)
+			{
+				const auto m = (cla::lane_abs(a[i][k]) > best);
+
+				best = cla::lane_select(m, cla::lane_abs(a[i][k]), best);
+				piv = cla::lane_select(m, P((float)i), piv);
+			}
+
+			for (auto i = k + 1; i < S; ++i)
+			{
+				const auto m = (piv == P((float)i));
+
+				for (std::size_t j = k; j < S; ++j)
+				{
+					const P t = a[k][j];
+
+					a[k][j] = cla::lane_select(m, a[i][j], t);
+					a[i][j] = cla::lane_select(m, t, a[i][j]);
+				}
+
+				const P t = b[k];
+
+				b[k] = cla::lane_select(m, b[i], t);
+				b[i] = cla::lane_select(m, t, b[i]);
+			}
+
+			for (auto i = k + 1; i < S; ++i)
+			{
+				const P l = a[i][k] / a[k][k];
+
+				for (auto j = k + 1; j < S; ++j) a[i][j] -= l * a[k][j];
+
+				b[i] -= l * b[k];
+			}
+		}
+
+		for (auto i = S; i-- > 0;)
+		{
+			for (auto j = i + 1; j < S; ++j) b[i] -= a[i][j] * b[j];
+
+			b[i] /= a[i][i];
+		}
+	}
+
+	//in-place Cholesky solve on lane packs; lanes that are not positive definite come out nan
+	template<typename P, std::size_t S>
+	inline auto cholesky_solve_lanes(P (&a)[S][S], P (&b)[S]) noexcept
+	{
+		for (std::size_t j = 0; j < S; ++j)
+		{
+			for (std::size_t k = 0; k < j; ++k) a[j][j] -= a[j][k] * a[j][k];
+
+			a[j][j] = cla::lane_sqrt(a[j][j]);
+
+			for (auto i = j + 1; i < S; ++i)
+			{
+				for (std::size_t k = 0; k < j; ++k) a[i][j] -= a[i][k] * a[j][k];
+
+				a[i][j] /= a[j][j];
+			}
+		}
+
+		for (std::size_t i = 0; i < S; ++i)
+		{
+			for (std::size_t k = 0; k < i; ++k) b[i] -= a[i][k] * b[k];
+
+			b[i] /= a[i][i];
+		}
+
+		for (auto i = S; i-- > 0;)
+		{
+			for (auto k = i + 1; k < S; ++k) b[i] -= a[k][i] * b[k];
+
+			b[i] /= a[i][i];
+		}
+	}
+
+	//runs Kernel over every system; with AVX, float systems are transposed eight at a time into lane packs
+	template<std::size_t S, typename T, typename Kernel>
+	inline auto solve_batch(std::span<const cla::matrix<T, S>> a, std::span<const std::array<T, S>> b, std::span<std::array<T, S>> x, Kernel kernel) noexcept
+	{
+		const auto count = std::min({ a.size(), b.size(), x.size() });
+
+		std::size_t n = 0;
+
+#if defined(__AVX__)
+		if constexpr (std::is_same_v<T, float>)
+		{
+			alignas(32) float lanes[8];
+
+			for (; n + 8 <= count; n += 8)
+			{
+				cla::float_x8 pa[S][S], pb[S];
+
+				for (std::size_t i = 0; i < S; ++i)
+				{
+					for (std::size_t j = 0; j < S; ++j)
+					{
+						pa[i][j] = _mm256_setr_ps(a[n + 0].data[i][j], a[n + 1].data[i][j], a[n + 2].data[i][j], a[n + 3].data[i][j], a[n + 4].data[i][j], a[n + 5].data[i][j], a[n + 6].data[i][j], a[n + 7].data[i][j]);
+					}
+
+					pb[i] = _mm256_setr_ps(b[n + 0][i], b[n + 1][i], b[n + 2][i], b[n + 3][i], b[n + 4][i], b[n + 5][i], b[n + 6][i], b[n + 7][i]);
+				}
+
+				kernel(pa, pb);
+
+				for (std::size_t i = 0; i < S; ++i)
+				{
+					_mm256_store_ps(lanes, pb[i].v);
+
+					for (auto l = 0; l < 8; ++l) x[n + l][i] = lanes[l];
+				}
+			}
+		}
+#endif
+
+		for (; n < count; ++n)
+		{
+			T pa[S][S], pb[S];
+
+			for (std::size_t i = 0; i < S; ++i)
+			{
+				for (std::size_t j = 0; j < S; ++j) pa[i][j] = a[n].data[i][j];
+
+				pb[i] = b[n][i];
+			}
+
+			kernel(pa, pb);
+
+			for (std::size_t i = 0; i < S; ++i) x[n][i] = pb[i];
+		}
+
+		return x.first(count);
+	}
+
+	//batched A x = b by partial-pivot LU over contiguous systems; S must be given explicitly, e.g. cla::solve<4>(as, bs, xs)
+	template<std::size_t S, typename T = float>
+	inline auto solve(std::span<const cla::matrix<T, S>> a, std::span<const std::array<T, S>> b, std::span<std::array<T, S>> x) noexcept
+	{
+		return cla::solve_batch<S, T>(a, b, x, [](auto& pa, auto& pb) { cla::lu_solve_lanes(pa, pb); });
+	}
+
+	//batched symmetric positive definite solve; takes the matrices A and factors them internally
+	template<std::size_t S, typename T = float>
+	inline auto cholesky_solve(std::span<const cla::matrix<T, S>> a, std::span<const std::array<T, S>> b, std::span<std::array<T, S>> x) noexcept
+	{
+		return cla::solve_batch<S, T>(a, b, x, [](auto& pa, auto& pb) { cla::cholesky_solve_lanes(pa, pb); });
+	}
+
+	//batched least squares; Householder sweeps are column-serial, so systems are solved one at a time
+	template<std::size_t R, std::size_t C, typename T = float>
+	inline auto qr_solve(std::span<const cla::matrix<T, R, C>> a, std::span<const std::array<T, R>> b, std::span<std::array<T, C>> x) noexcept
+	{
+		const auto count = std::min({ a.size(), b.size(), x.size() });
+
+		for (std::size_t n = 0; n < count; ++n)
+		{
+			x[n] = cla::qr_solve(cla::qr(a[n]), b[n]);
+		}
+
+		return x.first(count);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,339 @@
+module;
+#include <algorithm>
+#include <numeric>
+#include <vector>
+#include <span>
+#include <map>
+#include <tuple>
+#include <array>
+#include <utility>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+export module sparse;
+
+import core;
+import lanes;
+
+export namespace cla
+{
+	template<typename T = float>
+	struct triplet
+	{
+		std::uint32_t row, col;
+
+		T value;
+	};
+
+	//csr compresses rows (offsets per row, column indices), csc compresses columns (offsets per column, row indices)
+	enum class sparse_layout { csr, csc };
+
+	template<typename T = float, cla::sparse_layout Layout = cla::sparse_layout::csr>
+	class sparse
+	{
+	public:
+		std::size_t rows = 0, cols = 0;
+
+		//entries of major line k are [offsets[k], offsets[k + 1]), sorted by minor index
+		std::vector<std::uint32_t> offsets, indices;
+		std::vector<T> values;
+
+		std::size_t nnz() const noexcept { return values.size(); }
+
+		std::size_t majors() const noexcept { return (Layout == cla::sparse_layout::csr) ? rows : cols; }
+	};
+
+	template<typename T = float>
+	using csr_matrix = sparse<T, cla::sparse_layout::csr>;
+
+	template<typename T = float>
+	using csc_matrix = sparse<T, cla::sparse_layout::csc>;
+
+	//rows of a csr product handed to one thread at minimum
+	constexpr auto sparse_grain = static_cast<std::size_t>(1 << 14);
+
+	//duplicates are summed, explicit zeros are kept; entries outside rows x cols are dropped
+	template<cla::sparse_layout Layout = cla::sparse_layout::csr, typename T = float>
+	auto from_triplets(std::size_t rows, std::size_t cols, const std::vector<cla::triplet<T>>& entries)
+	{
+		cla::sparse<T, Layout> mat;
+		mat.rows = rows; mat.cols = cols;
+
+		constexpr bool byRow = (Layout == cla::sparse_layout::csr);
+
+		const auto major = [](const cla::triplet<T>& e) { return byRow ? e.row : e.col; };
+		const auto minor = [](const cla::triplet<T>& e) { return byRow ? e.col : e.row; };
+
+		//counting sort on the major index, then sort and merge each line by minor index
+		std::vector<std::uint32_t> counts(mat.majors() + 1, 0);
+
+		for (const auto& e : entries)
+		{
+			if (e.row < rows && e.col < cols) ++counts[major(e) + 1];
+		}
+
+		std::partial_sum(counts.begin(), counts.end(), counts.begin());
+
+		std::vector<cla::triplet<T>> bucketed(counts.back());
+		auto next = counts;
+
+		for (const auto& e : entries)
+		{
+			if (e.row < rows && e.col < cols) bucketed[next[major(e)]++] = e;
+		}
+
+		mat.offsets.assign(mat.majors() + 1, 0);
+		mat.indices.reserve(bucketed.size());
+		mat.values.reserve(bucketed.size());
+
+		for (std::size_t k = 0; k < mat.majors(); ++k)
+		{
+			const auto first = bucketed.begin() + counts[k], last = bucketed.begin() + counts[k + 1];
+
+			std::sort(first, last, [&](const auto& a, const auto& b) { return minor(a) < minor(b); });
+
+			for (auto it = first; it != last; ++it)
+			{
+				if (it != first && minor(*it) == mat.indices.back()) mat.values.back() += it->value;
+				else { mat.indices.push_back(minor(*it)); mat.values.push_back(it->value); }
+			}
+
+			mat.offsets[k + 1] = static_cast<std::uint32_t>(mat.values.size());
+		}
+
+		return mat;
+	}
+
+	//same matrix in the other layout
+	template<cla::sparse_layout To, typename T = float, cla::sparse_layout From>
+	auto convert(const cla::sparse<T, From>& mat)
+	{
+		if constexpr (To == From) return mat;
+		else
+		{
+			std::vector<cla::triplet<T>> entries;
+			entries.reserve(mat.nnz());
+
+			for (std::size_t k = 0; k < mat.majors(); ++k)
+			{
+				for (auto e = mat.offsets[k]; e < mat.offsets[k + 1]; ++e)
+				{
+					const auto major = static_cast<std::uint32_t>(k), minor = mat.indices[e];
+
+					if constexpr (From == cla::sparse_layout::csr) entries.push_back({ major, minor, mat.values[e] });
+					else entries.push_back({ minor, major, mat.values[e] });
+				}
+			}
+
+			return cla::from_triplets<To>(mat.rows, mat.cols, entries);
+		}
+	}
+
+	//y = A x over min(rows, y.size()) rows; csr rows are independent and split across threads, csc scatters into y serially
+	template<bool Parallel = true, typename T = float, cla::sparse_layout Layout>
+	auto mul(const cla::sparse<T, Layout>& mat, std::span<const std::type_identity_t<T>> x, std::span<std::type_identity_t<T>> y)
+	{
+		const auto count = std::min(mat.rows, y.size());
+
+		if (x.size() < mat.cols) return y.first(0);
+
+		if constexpr (Layout == cla::sparse_layout::csr)
+		{
+			cla::parallel_for(count, Parallel ? cla::sparse_grain : count, [&](std::size_t begin, std::size_t end)
+			{
+				for (auto i = begin; i < end; ++i)
+				{
+					T sum = (T)0.0f;
+
+					for (auto e = mat.offsets[i]; e < mat.offsets[i + 1]; ++e) sum += mat.values[e] * x[mat.indices[e]];
+
+					y[i] = sum;
+				}
+			});
+		}
+		else
+		{
+			std::fill(y.begin(), y.begin() + count, (T)0.0f);
+
+			for (std::size_t j = 0; j < mat.cols; ++j)
+			{
+				for (auto e = mat.offsets[j]; e < mat.offsets[j + 1]; ++e)
+				{
+					if (mat.indices[e] < count) y[mat.indices[e]] += mat.values[e] * x[j];
+				}
+			}
+		}
+
+		return y.first(count);
+	}
+
+	//dense dot product over min of both sizes; four pack accumulators hide add latency
+	template<typename T = float>
+	auto dot(std::span<const std::type_identity_t<T>> x, std::span<const std::type_identity_t<T>> y) noexcept
+	{
+		using P = cla::lane_pack<T>;
+		constexpr auto W = cla::lane_width<T>;
+
+		const auto n = std::min(x.size(), y.size());
+
+		std::size_t i = 0;
+
+		T sum = (T)0.0f;
+
+		if constexpr (W > 1)
+		{
+			P acc[4] = { P((T)0.0f), P((T)0.0f), P((T)0.0f), P((T)0.0f) };
+
+			for (; i + 4 * W <= n; i += 4 * W)
+			{
+				for (auto k = 0; k < 4; ++k) acc[k] += cla::lane_load<P>(&x[i + k * W]) * cla::lane_load<P>(&y[i + k * W]);
+			}
+
+			alignas(64) T lanes[W];
+			cla::lane_store(lanes, (acc[0] + acc[1]) + (acc[2] + acc[3]));
+
+			for (auto l = 0; l < W; ++l) sum += lanes[l];
+		}
+
+		for (; i < n; ++i) sum += x[i] * y[i];
+
+		return sum;
+	}
+
+	//y += a x over min of both sizes
+	template<typename T = float>
+	auto axpy(const T& a, std::span<const std::type_identity_t<T>> x, std::span<std::type_identity_t<T>> y) noexcept
+	{
+		using P = cla::lane_pack<T>;
+		constexpr auto W = cla::lane_width<T>;
+
+		const auto n = std::min(x.size(), y.size());
+
+		std::size_t i = 0;
+
+		if constexpr (W > 1)
+		{
+			const P scale(a);
+
+			for (; i + W <= n; i += W) cla::lane_store(&y[i], cla::lane_load<P>(&y[i]) + scale * cla::lane_load<P>(&x[i]));
+		}
+
+		for (; i < n; ++i) y[i] += a * x[i];
+	}
+
+	//solves A x = b for symmetric positive definite A, starting from the contents of x;
+	//stops once |r| <= tolerance * |b| or after maxIterations (0 means rows) and returns { iterations, |r| };
+	//a non-square A or b, x shorter than its rows leaves x untouched and returns { 0, nan }
+	template<typename T = float>
+	auto conjugate_gradient(const cla::csr_matrix<T>& mat, std::span<const std::type_identity_t<T>> b, std::span<std::type_identity_t<T>> x, const T& tolerance = (T)1e-6f, std::size_t maxIterations = 0)
+	{
+		const auto n = mat.rows;
+
+		if (mat.cols != n || b.size() < n || x.size() < n) return std::pair{ static_cast<std::size_t>(0), std::numeric_limits<T>::quiet_NaN() };
+
+		std::vector<T> r(n), p(n), ap(n);
+
+		cla::mul(mat, std::span<const T>(x), std::span<T>(ap));
+
+		for (std::size_t i = 0; i < n; ++i) r[i] = b[i] - ap[i];
+
+		p = r;
+
+		T rr = cla::dot<T>(r, r);
+
+		const T limit = tolerance * tolerance * cla::dot<T>(b.first(n), b.first(n));
+
+		if (maxIterations == 0) maxIterations = n;
+
+		std::size_t it = 0;
+
+		for (; it < maxIterations && rr > limit; ++it)
+		{
+			cla::mul(mat, std::span<const T>(p), std::span<T>(ap));
+
+			const T alpha = rr / cla::dot<T>(p, ap);
+
+			cla::axpy<T>(alpha, p, x);
+			cla::axpy<T>(-alpha, ap, r);
+
+			const T rrNext = cla::dot<T>(r, r);
+			const T beta = rrNext / rr;
+
+			rr = rrNext;
+
+			for (std::size_t i = 0; i < n; ++i) p[i] = r[i] + beta * p[i];
+		}
+
+		return std::pair{ it, (T)std::sqrt(rr) };
+	}
+
+	//uniform graph Laplacian: degree on the diagonal, -1 for every edge; symmetric positive semi-definite
+	template<typename T = float>
+	auto laplacian(std::size_t vertices, std::span<const std::array<std::uint32_t, 3>> faces)
+	{
+		std::vector<cla::triplet<T>> entries;
+		entries.reserve(faces.size() * 6);
+
+		for (const auto& f : faces)
+		{
+			for (auto k = 0; k < 3; ++k)
+			{
+				const auto a = f[k], b = f[(k + 1) % 3];
+
+				if (a == b) continue;
+
+				entries.push_back({ a, b, (T)-1.0f });
+				entries.push_back({ b, a, (T)-1.0f });
+			}
+		}
+
+		for (std::uint32_t v = 0; v < vertices; ++v) entries.push_back({ v, v, (T)0.0f });
+
+		auto mat = cla::from_triplets(vertices, vertices, entries);
+
+		//edges shared by two faces were summed twice; reset them and rebuild the degree
+		for (std::size_t i = 0; i < vertices; ++i)
+		{
+			T degree = (T)0.0f;
+			std::size_t diagonal = mat.offsets[i];
+
+			for (auto e = mat.offsets[i]; e < mat.offsets[i + 1]; ++e)
+			{
+				if (mat.indices[e] == i) { diagonal = e; continue; }
+
+				mat.values[e] = (T)-1.0f;
+				degree += (T)1.0f;
+			}
+
+			mat.values[diagonal] = degree;
+		}
+
+		return mat;
+	}
+
+	//welds the triangle soup from cla::loadOBJ by exact position and returns { laplacian, welded positions }
+	inline auto laplacian(const std::vector<cla::tri<float>>& tris)
+	{
+		std::map<std::tuple<float, float, float>, std::uint32_t> lookup;
+		std::vector<cla::vf3d> positions;
+		std::vector<std::array<std::uint32_t, 3>> faces;
+		faces.reserve(tris.size());
+
+		const auto weld = [&](const cla::vf3d& p)
+		{
+			const auto [it, added] = lookup.try_emplace({ p.x, p.y, p.z }, static_cast<std::uint32_t>(positions.size()));
+
+			if (added) positions.push_back(p);
+
+			return it->second;
+		};
+
+		for (const auto& t : tris)
+		{
+			faces.push_back({ weld(t.p1), weld(t.p2), weld(t.p3) });
+		}
+
+		return std::pair{ cla::laplacian<float>(positions.size(), faces), positions };
+	}
+}
\ No newline at end of file
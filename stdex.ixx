@@ -3,6 +3,7 @@ module;
 #include <tuple>
 #include <string>
 #include <fstream>
+#include <limits>
 export module stdex;
 
 import core;
@@ -28,17 +29,24 @@ export namespace std
 	{
 		if (std::is_constant_evaluated())
 		{
-			T z = T{ 1 };
+			if (!(arg > T{})) return (arg == T{}) ? T{} : std::numeric_limits<T>::quiet_NaN();
 
-			for (int i = 0; i < 10; ++i)
+			//newton's method from above decreases monotonically, so stop as soon as it no longer does
+			T z = (arg > T{ 1 }) ? arg : T{ 1 };
+
+			for (int i = 0; i < 1024; ++i)
 			{
-				z -= (z * z - arg) / (2 * z);
+				const T next = (z + arg / z) / 2;
+
+				if (!(next < z)) break;
+
+				z = next;
 			}
 
 			return z;
 		}
 
-		else return static_cast<T>(std::sqrtf(arg));
+		else return static_cast<T>(std::sqrt(arg));
 	}
 
 	template<typename T, typename... Ts>
@@ -0,0 +1,152 @@
+module;
+#include <algorithm>
+#include <numeric>
+#include <vector>
+#include <cstdint>
+export module tree;
+
+import core;
+import matrix;
+
+export namespace cla
+{
+	//levels narrower than this are updated on the calling thread
+	constexpr auto transform_tree_grain = static_cast<std::size_t>(1 << 10);
+
+	//parent/child hierarchy of local transforms with cached world transforms; M is cla::matrix<T, 4> or cla::affine3x4<T>
+	//world = local * parent world, matching the row-vector order of cla::compose. Nodes are kept sorted by depth so update()
+	//walks memory front to back one level at a time, and every node in a level can be recomputed independently
+	template<typename M = cla::float4x4>
+	class transform_tree
+	{
+	public:
+		using node = std::uint32_t;
+
+		static constexpr node none = ~node(0);
+
+		//parent must already exist; the new node starts dirty
+		node add(const M& local, node parent = none)
+		{
+			const auto id = static_cast<node>(slots.size());
+			const auto parentSlot = (parent == none) ? none : slots[parent];
+			const auto depth = (parent == none) ? 0u : depths[parentSlot] + 1;
+
+			if (!depths.empty() && depth < depths.back()) sorted = false;
+
+			slots.push_back(static_cast<node>(ids.size()));
+			ids.push_back(id);
+			parents.push_back(parentSlot);
+			depths.push_back(depth);
+			locals.push_back(local);
+			worlds.push_back(local);
+			dirty.push_back(1);
+			moved.push_back(1);
+
+			pending = true;
+
+			return id;
+		}
+
+		void set_local(node n, const M& local) noexcept
+		{
+			locals[slots[n]] = local;
+			dirty[slots[n]] = 1;
+
+			pending = true;
+		}
+
+		const M& local(node n) const noexcept { return locals[slots[n]]; }
+
+		//valid as of the last update()
+		const M& world(node n) const noexcept { return worlds[slots[n]]; }
+
+		//true when the last update() rewrote this node's world transform
+		bool changed(node n) const noexcept { return moved[slots[n]] != 0; }
+
+		node parent(node n) const noexcept { return (parents[slots[n]] == none) ? none : ids[parents[slots[n]]]; }
+
+		std::size_t size() const noexcept { return ids.size(); }
+
+		//recomputes world transforms of dirty nodes and everything below them; clean subtrees are only flag-checked
+		template<bool Parallel = true>
+		void update()
+		{
+			if (!pending)
+			{
+				std::fill(moved.begin(), moved.end(), std::uint8_t(0));
+
+				return;
+			}
+
+			if (!sorted) sort_levels();
+
+			std::size_t begin = 0;
+
+			while (begin < ids.size())
+			{
+				auto end = begin;
+
+				while (end < ids.size() && depths[end] == depths[begin]) ++end;
+
+				const auto work = [&](std::size_t first, std::size_t last)
+				{
+					for (auto s = begin + first; s < begin + last; ++s)
+					{
+						const auto p = parents[s];
+
+						moved[s] = dirty[s] | ((p == none) ? std::uint8_t(0) : moved[p]);
+						dirty[s] = 0;
+
+						if (moved[s]) worlds[s] = (p == none) ? locals[s] : cla::compose(locals[s], worlds[p]);
+					}
+				};
+
+				if constexpr (Parallel) cla::parallel_for(end - begin, cla::transform_tree_grain, work);
+				else work(0, end - begin);
+
+				begin = end;
+			}
+
+			pending = false;
+		}
+
+	private:
+		//id -> slot and slot -> id; every per-node array below is indexed by slot
+		std::vector<node> slots, ids;
+
+		std::vector<node> parents;
+		std::vector<std::uint32_t> depths;
+
+		cla::aligned_vector<M> locals, worlds;
+
+		std::vector<std::uint8_t> dirty, moved;
+
+		bool sorted = true, pending = false;
+
+		//stable reorder by depth; parents stay ahead of their children and siblings stay in insertion order
+		void sort_levels()
+		{
+			std::vector<node> order(ids.size());
+			std::iota(order.begin(), order.end(), node(0));
+			std::stable_sort(order.begin(), order.end(), [&](node a, node b) { return depths[a] < depths[b]; });
+
+			std::vector<node> rank(order.size());
+			for (std::size_t s = 0; s < order.size(); ++s) rank[order[s]] = static_cast<node>(s);
+
+			const auto permute = [&](auto& values)
+			{
+				auto copy = values;
+
+				for (std::size_t s = 0; s < order.size(); ++s) values[s] = copy[order[s]];
+			};
+
+			permute(ids); permute(parents); permute(depths); permute(locals); permute(worlds); permute(dirty); permute(moved);
+
+			for (auto& p : parents) if (p != none) p = rank[p];
+
+			for (std::size_t s = 0; s < ids.size(); ++s) slots[ids[s]] = static_cast<node>(s);
+
+			sorted = true;
+		}
+	};
+}
\ No newline at end of file
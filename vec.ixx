@@ -0,0 +1,181 @@
+module;
+#include <array>
+#include <utility>
+#include <functional>
+#include <type_traits>
+#include <cstdint>
+export module vec;
+
+import stdex;
+import core;
+
+export namespace cla
+{
+	//register-sized vectors (float2, float4, double4, ...) are aligned to their size so loads never split;
+	//other sizes keep the element alignment so arrays of them stay densely packed
+	template<typename T, std::size_t N>
+	constexpr std::size_t vec_alignment = ((N * sizeof(T)) & (N * sizeof(T) - 1)) == 0 && N * sizeof(T) <= 64 ? N * sizeof(T) : alignof(T);
+
+	//N contiguous elements with no padding inside; every operation below is a fold over an index pack, so there are no
+	//loops for the optimizer to prove anything about and each lane is an independent expression it can put in one register
+	template<typename T = float, std::size_t N = 3>
+	struct alignas(cla::vec_alignment<T, N>) vec
+	{
+		std::array<T, N> data;
+
+		constexpr T& operator[](std::size_t i) noexcept { return data[i]; }
+		constexpr const T& operator[](std::size_t i) const noexcept { return data[i]; }
+
+		static constexpr std::size_t size() noexcept { return N; }
+	};
+
+	template<typename T = float> using vec2 = vec<T, 2>;
+	template<typename T = float> using vec3 = vec<T, 3>;
+	template<typename T = float> using vec4 = vec<T, 4>;
+
+	using float2 = vec<float, 2>;
+	using float3 = vec<float, 3>;
+	using float4 = vec<float, 4>;
+
+	using double2 = vec<double, 2>;
+	using double3 = vec<double, 3>;
+	using double4 = vec<double, 4>;
+
+	using int2 = vec<int32_t, 2>;
+	using int3 = vec<int32_t, 3>;
+	using int4 = vec<int32_t, 4>;
+
+	template<typename binaryop, typename T, std::size_t N, std::size_t... I>
+	constexpr auto zip(const cla::vec<T, N>& vec1, const cla::vec<T, N>& vec2, std::index_sequence<I...>) noexcept
+	{
+		return cla::vec<T, N>{ { binaryop{}(vec1.data[I], vec2.data[I])... } };
+	}
+
+	template<typename binaryop = std::multiplies<void>, typename T = float, std::size_t N = 3>
+	constexpr auto reduce(const cla::vec<T, N>& vec1, const cla::vec<T, N>& vec2) noexcept
+	{
+		return cla::zip<binaryop>(vec1, vec2, std::make_index_sequence<N>{});
+	}
+
+	template<typename binaryop = std::multiplies<void>, typename T = float, std::size_t N = 3>
+	constexpr auto apply(const cla::vec<T, N>& vec, const T& operand) noexcept
+	{
+		return [&]<std::size_t... I>(std::index_sequence<I...>) { return cla::vec<T, N>{ { binaryop{}(vec.data[I], operand)... } }; }(std::make_index_sequence<N>{});
+	}
+
+	template<typename T = float, std::size_t N = 3>
+	constexpr auto sum(const cla::vec<T, N>& vec) noexcept
+	{
+		return [&]<std::size_t... I>(std::index_sequence<I...>) { return (vec.data[I] + ...); }(std::make_index_sequence<N>{});
+	}
+
+	template<typename T = float, std::size_t N = 3>
+	constexpr auto dot(const cla::vec<T, N>& vec1, const cla::vec<T, N>& vec2) noexcept
+	{
+		return [&]<std::size_t... I>(std::index_sequence<I...>) { return ((vec1.data[I] * vec2.data[I]) + ...); }(std::make_index_sequence<N>{});
+	}
+
+	template<typename T = float, std::size_t N = 3>
+	constexpr auto length2(const cla::vec<T, N>& vec) noexcept
+	{
+		return cla::dot(vec, vec);
+	}
+
+	template<typename T = float, std::size_t N = 3>
+	constexpr auto norm(const cla::vec<T, N>& vec) noexcept
+	{
+		return std::my_sqrt(cla::length2(vec));
+	}
+
+	template<typename T = float, std::size_t N = 3>
+	constexpr auto normalize(const cla::vec<T, N>& vec) noexcept
+	{
+		return cla::apply<std::divides<>>(vec, cla::norm(vec));
+	}
+
+	//row vector times R x C matrix, matching cla::mul's row-vector convention for any size
+	template<typename T = float, std::size_t R = 4, std::size_t C = R>
+	constexpr auto mul(const cla::vec<T, R>& vec, const cla::matrix<T, R, C>& mat) noexcept
+	{
+		const auto column = [&]<std::size_t... I>(std::size_t j, std::index_sequence<I...>) { return ((vec.data[I] * mat.data[I][j]) + ...); };
+
+		return [&]<std::size_t... J>(std::index_sequence<J...>) { return cla::vec<T, C>{ { column(J, std::make_index_sequence<R>{})... } }; }(std::make_index_sequence<C>{});
+	}
+
+	//R x C matrix times column vector
+	template<typename T = float, std::size_t R = 4, std::size_t C = R>
+	constexpr auto mul(const cla::matrix<T, R, C>& mat, const cla::vec<T, C>& vec) noexcept
+	{
+		const auto row = [&]<std::size_t... J>(std::size_t i, std::index_sequence<J...>) { return ((mat.data[i][J] * vec.data[J]) + ...); };
+
+		return [&]<std::size_t... I>(std::index_sequence<I...>) { return cla::vec<T, R>{ { row(I, std::make_index_sequence<C>{})... } }; }(std::make_index_sequence<R>{});
+	}
+
+	//(x, y, z, w) from a v3d_generic and back
+	template<typename T = float>
+	constexpr auto to_vec(const cla::v3d_generic<T>& vec) noexcept
+	{
+		return cla::vec<T, 4>{ { vec.x, vec.y, vec.z, vec.w } };
+	}
+
+	template<typename T = float, std::size_t N = 4>
+	constexpr auto to_v3d(const cla::vec<T, N>& vec) noexcept requires (N == 3 || N == 4)
+	{
+		cla::v3d_generic<T> outVec(vec.data[0], vec.data[1], vec.data[2]);
+
+		if constexpr (N == 4) outVec.w = vec.data[3];
+
+		return outVec;
+	}
+
+	template<typename T = float, std::size_t N = 3>
+	constexpr auto operator+(const cla::vec<T, N>& vec1, const cla::vec<T, N>& vec2) noexcept { return cla::reduce<std::plus<>>(vec1, vec2); }
+
+	template<typename T = float, std::size_t N = 3>
+	constexpr auto operator-(const cla::vec<T, N>& vec1, const cla::vec<T, N>& vec2) noexcept { return cla::reduce<std::minus<>>(vec1, vec2); }
+
+	template<typename T = float, std::size_t N = 3>
+	constexpr auto operator*(const cla::vec<T, N>& vec1, const cla::vec<T, N>& vec2) noexcept { return cla::reduce<std::multiplies<>>(vec1, vec2); }
+
+	template<typename T = float, std::size_t N = 3>
+	constexpr auto operator/(const cla::vec<T, N>& vec1, const cla::vec<T, N>& vec2) noexcept { return cla::reduce<std::divides<>>(vec1, vec2); }
+
+	template<typename T = float, std::size_t N = 3>
+	constexpr auto operator+(const cla::vec<T, N>& vec, const std::type_identity_t<T>& operand) noexcept { return cla::apply<std::plus<>>(vec, operand); }
+
+	template<typename T = float, std::size_t N = 3>
+	constexpr auto operator-(const cla::vec<T, N>& vec, const std::type_identity_t<T>& operand) noexcept { return cla::apply<std::minus<>>(vec, operand); }
+
+	template<typename T = float, std::size_t N = 3>
+	constexpr auto operator*(const cla::vec<T, N>& vec, const std::type_identity_t<T>& operand) noexcept { return cla::apply<std::multiplies<>>(vec, operand); }
+
+	template<typename T = float, std::size_t N = 3>
+	constexpr auto operator/(const cla::vec<T, N>& vec, const std::type_identity_t<T>& operand) noexcept { return cla::apply<std::divides<>>(vec, operand); }
+
+	template<typename T = float, std::size_t N = 3>
+	constexpr auto operator*(const std::type_identity_t<T>& operand, const cla::vec<T, N>& vec) noexcept { return cla::apply<std::multiplies<>>(vec, operand); }
+
+	template<typename T = float, std::size_t N = 3>
+	constexpr auto operator-(const cla::vec<T, N>& vec) noexcept { return cla::apply<std::multiplies<>>(vec, (T)-1); }
+
+	template<typename T = float, std::size_t N = 3>
+	constexpr auto& operator+=(cla::vec<T, N>& vec1, const cla::vec<T, N>& vec2) noexcept { return vec1 = vec1 + vec2; }
+
+	template<typename T = float, std::size_t N = 3>
+	constexpr auto& operator-=(cla::vec<T, N>& vec1, const cla::vec<T, N>& vec2) noexcept { return vec1 = vec1 - vec2; }
+
+	template<typename T = float, std::size_t N = 3>
+	constexpr auto& operator*=(cla::vec<T, N>& vec, const std::type_identity_t<T>& operand) noexcept { return vec = vec * operand; }
+
+	template<typename T = float, std::size_t N = 3>
+	constexpr auto& operator/=(cla::vec<T, N>& vec, const std::type_identity_t<T>& operand) noexcept { return vec = vec / operand; }
+
+	template<typename T = float, std::size_t N = 3>
+	constexpr bool operator==(const cla::vec<T, N>& vec1, const cla::vec<T, N>& vec2) noexcept { return vec1.data == vec2.data; }
+
+	template<typename T = float, std::size_t R = 4, std::size_t C = R>
+	constexpr auto operator*(const cla::vec<T, R>& vec, const cla::matrix<T, R, C>& mat) noexcept { return cla::mul(vec, mat); }
+
+	template<typename T = float, std::size_t R = 4, std::size_t C = R>
+	constexpr auto operator*(const cla::matrix<T, R, C>& mat, const cla::vec<T, C>& vec) noexcept { return cla::mul(mat, vec); }
+}
\ No newline at end of file
@@ -2,18 +2,25 @@ module;
 #include <tuple>
 #include <type_traits>
 #include <functional>
+#include <span>
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <cmath>
+#include <immintrin.h>
 //#include <concepts>
 export module vector;
 
 import stdex;
 import core;
+import dispatch;
 
 export namespace cla
 {
 	template<typename binaryop = std::multiplies<void>, typename T = float>
 	constexpr auto apply(const cla::v3d_generic<T>& vec, const T& operand) noexcept
 	{
-		cla::vf3d outVec;
+		cla::v3d_generic<T> outVec;
 	
 		outVec.x = binaryop{}(vec.x, operand);
 		outVec.y = binaryop{}(vec.y, operand);
@@ -25,7 +32,7 @@ export namespace cla
 	template<typename binaryop = std::multiplies<void>, typename T = float>
 	constexpr auto reduce(const cla::v3d_generic<T>& vec1, const cla::v3d_generic<T>& vec2) noexcept
 	{
-		cla::vf3d outVec;
+		cla::v3d_generic<T> outVec;
 
 		outVec.x = binaryop{}(vec1.x, vec2.x);
 		outVec.y = binaryop{}(vec1.y, vec2.y);
@@ -46,25 +53,150 @@ export namespace cla
 		return cla::sum(cla::reduce<std::multiplies<>>(vec, vec));
 	}
 
-	template<typename T = float>
+	//precision of length, normalize and dot<Normalize>; max relative error against the exactly rounded float result:
+	//exact   - sqrt and divide, 1 ulp
+	//fast    - rsqrt estimate plus one Newton-Raphson step, 3e-7 (about 2.5 ulp)
+	//fastest - raw rsqrt estimate, 3.7e-4 (the 1.5 * 2^-12 hardware bound)
+	//double seeds the same float estimate from its range-reduced mantissa, so its fast and fastest bounds are the float ones
+	//over the whole double range; constant evaluation is always exact
+	enum class accuracy { exact, fast, fastest };
+
+	template<cla::accuracy Accuracy = cla::accuracy::exact, typename T = float>
+	constexpr auto rsqrt(const T& arg) noexcept
+	{
+		if constexpr (Accuracy != cla::accuracy::exact && std::is_floating_point_v<T>)
+		{
+			if (!std::is_constant_evaluated())
+			{
+				if constexpr (std::is_same_v<T, float>)
+				{
+					const T estimate = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(arg)));
+
+					if constexpr (Accuracy == cla::accuracy::fastest) return estimate;
+					else return estimate * (1.5f - 0.5f * arg * estimate * estimate);
+				}
+				else
+				{
+					//narrowing arg itself over- or underflows outside float range, so seed from the mantissa
+					//arg = m * 2^e with e even and m in [0.5, 2), then rsqrt(arg) = rsqrt(m) * 2^(-e/2)
+					int e = 0;
+					T m = std::frexp(arg, &e);
+
+					if (e & 1) m *= (T)2.0f, --e;
+
+					T estimate = (T)_mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss((float)m)));
+
+					if constexpr (Accuracy == cla::accuracy::fast) estimate *= ((T)1.5f - (T)0.5f * m * estimate * estimate);
+
+					return std::ldexp(estimate, -e / 2);
+				}
+			}
+		}
+
+		return (T)1.0f / std::my_sqrt(arg);
+	}
+
+	template<cla::accuracy Accuracy = cla::accuracy::exact, typename T = float>
 	constexpr auto length(const cla::v3d_generic<T>& vec) noexcept
 	{
-		return std::my_sqrt(cla::length2(vec));
+		const auto len2 = cla::length2(vec);
+
+		if constexpr (Accuracy == cla::accuracy::exact) return std::my_sqrt(len2);
+		else return (len2 == (T)0.0f) ? len2 : len2 * cla::rsqrt<Accuracy>(len2);
 	}
 
-	template<typename T = float>
+	template<cla::accuracy Accuracy = cla::accuracy::exact, typename T = float>
 	constexpr auto normalize(const cla::v3d_generic<T>& vec) noexcept
 	{
-		return cla::apply<std::divides<>>(vec, (cla::length(vec)));
+		if constexpr (Accuracy == cla::accuracy::exact) return cla::apply<std::divides<>>(vec, (cla::length(vec)));
+		else return cla::apply<std::multiplies<>>(vec, cla::rsqrt<Accuracy>(cla::length2(vec)));
 	}
 
-	template<bool Normalize = false, typename T = float>
+	template<bool Normalize = false, cla::accuracy Accuracy = cla::accuracy::exact, typename T = float>
 	constexpr auto dot(const cla::v3d_generic<T>& vec1, const cla::v3d_generic<T>& vec2) noexcept
 	{
-		if constexpr (Normalize) return cla::sum(cla::reduce<std::multiplies<>>(cla::normalize(vec1), cla::normalize(vec2)));
+		if constexpr (Normalize) return cla::sum(cla::reduce<std::multiplies<>>(cla::normalize<Accuracy>(vec1), cla::normalize<Accuracy>(vec2)));
 		else return cla::sum(cla::reduce<std::multiplies<>>(vec1, vec2));
 	}
 
+	//batched normalize and length over min of both span sizes; float runs four vertices per SSE register, w is written as 1
+	template<cla::accuracy Accuracy = cla::accuracy::exact, typename T = float>
+	auto normalize(std::span<const cla::v3d_generic<std::type_identity_t<T>>> in, std::span<cla::v3d_generic<std::type_identity_t<T>>> out) noexcept
+	{
+		const auto count = std::min(in.size(), out.size());
+
+		std::size_t i = 0;
+
+		if constexpr (std::is_same_v<T, float>)
+		{
+			for (; i + 4 <= count; i += 4)
+			{
+				__m128 x = _mm_loadu_ps(&in[i + 0].x), y = _mm_loadu_ps(&in[i + 1].x), z = _mm_loadu_ps(&in[i + 2].x), w = _mm_loadu_ps(&in[i + 3].x);
+				_MM_TRANSPOSE4_PS(x, y, z, w);
+
+				const __m128 len2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+
+				if constexpr (Accuracy == cla::accuracy::exact)
+				{
+					const __m128 len = _mm_sqrt_ps(len2);
+
+					x = _mm_div_ps(x, len); y = _mm_div_ps(y, len); z = _mm_div_ps(z, len);
+				}
+				else
+				{
+					__m128 r = _mm_rsqrt_ps(len2);
+
+					if constexpr (Accuracy == cla::accuracy::fast) r = _mm_mul_ps(r, _mm_sub_ps(_mm_set1_ps(1.5f), _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), len2), _mm_mul_ps(r, r))));
+
+					x = _mm_mul_ps(x, r); y = _mm_mul_ps(y, r); z = _mm_mul_ps(z, r);
+				}
+
+				w = _mm_set1_ps(1.0f);
+				_MM_TRANSPOSE4_PS(x, y, z, w);
+
+				_mm_storeu_ps(&out[i + 0].x, x); _mm_storeu_ps(&out[i + 1].x, y); _mm_storeu_ps(&out[i + 2].x, z); _mm_storeu_ps(&out[i + 3].x, w);
+			}
+		}
+
+		for (; i < count; ++i) out[i] = cla::normalize<Accuracy>(in[i]);
+
+		return out.first(count);
+	}
+
+	template<cla::accuracy Accuracy = cla::accuracy::exact, typename T = float>
+	auto length(std::span<const cla::v3d_generic<std::type_identity_t<T>>> in, std::span<std::type_identity_t<T>> out) noexcept
+	{
+		const auto count = std::min(in.size(), out.size());
+
+		std::size_t i = 0;
+
+		if constexpr (std::is_same_v<T, float>)
+		{
+			for (; i + 4 <= count; i += 4)
+			{
+				__m128 x = _mm_loadu_ps(&in[i + 0].x), y = _mm_loadu_ps(&in[i + 1].x), z = _mm_loadu_ps(&in[i + 2].x), w = _mm_loadu_ps(&in[i + 3].x);
+				_MM_TRANSPOSE4_PS(x, y, z, w);
+
+				const __m128 len2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+
+				if constexpr (Accuracy == cla::accuracy::exact) _mm_storeu_ps(&out[i], _mm_sqrt_ps(len2));
+				else
+				{
+					__m128 r = _mm_rsqrt_ps(len2);
+
+					if constexpr (Accuracy == cla::accuracy::fast) r = _mm_mul_ps(r, _mm_sub_ps(_mm_set1_ps(1.5f), _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), len2), _mm_mul_ps(r, r))));
+
+					//zero lengths would give 0 * inf
+					_mm_storeu_ps(&out[i], _mm_and_ps(_mm_mul_ps(len2, r), _mm_cmpneq_ps(len2, _mm_setzero_ps())));
+				}
+			}
+		}
+
+		for (; i < count; ++i) out[i] = cla::length<Accuracy>(in[i]);
+
+		return out.first(count);
+	}
+
 	template<typename T = float>
 	constexpr auto cross(const cla::v3d_generic<T>& vec1, const cla::v3d_generic<T>& vec2) noexcept
 	{
@@ -92,20 +224,232 @@ export namespace cla
 	}
 
 	template<typename T = float>
-	constexpr auto intersect(const cla::v3d_generic<T>& plane_p, const cla::v3d_generic<T>& plane_n, const cla::v3d_generic<T>& lineStart, const cla::v3d_generic<T>& lineEnd) noexcept
+	constexpr auto mul(const cla::v3d_generic<T>& vec, const cla::affine3x4<T>& aff) noexcept
+	{
+		cla::v3d_generic<T> outVec;
+
+		outVec.x = vec.x * aff.data[0][0] + vec.y * aff.data[1][0] + vec.z * aff.data[2][0] + aff.data[3][0];
+		outVec.y = vec.x * aff.data[0][1] + vec.y * aff.data[1][1] + vec.z * aff.data[2][1] + aff.data[3][1];
+		outVec.z = vec.x * aff.data[0][2] + vec.y * aff.data[1][2] + vec.z * aff.data[2][2] + aff.data[3][2];
+
+		return outVec;
+	}
+
+	//transforms a direction; the translation row is ignored
+	template<typename T = float>
+	constexpr auto mul_direction(const cla::v3d_generic<T>& vec, const cla::affine3x4<T>& aff) noexcept
+	{
+		cla::v3d_generic<T> outVec;
+
+		outVec.x = vec.x * aff.data[0][0] + vec.y * aff.data[1][0] + vec.z * aff.data[2][0];
+		outVec.y = vec.x * aff.data[0][1] + vec.y * aff.data[1][1] + vec.z * aff.data[2][1];
+		outVec.z = vec.x * aff.data[0][2] + vec.y * aff.data[1][2] + vec.z * aff.data[2][2];
+
+		return outVec;
+	}
+
+	//transforms count vertices as rows against mat with the runtime-selected kernel; in and out may be the same buffer
+	inline auto transform_simd(const cla::vf3d* in, cla::vf3d* out, std::size_t count, const cla::matrix<float, 4>& mat) noexcept
+	{
+		static_assert(sizeof(cla::vf3d) == 4 * sizeof(float), "vf3d must be four packed floats");
+
+		cla::simd_table().transform(reinterpret_cast<const float*>(in), reinterpret_cast<float*>(out), count, mat.data[0].data());
+	}
+
+	//smallest per-thread share of vertices worth spawning a worker for
+	constexpr auto transform_grain = static_cast<std::size_t>(1 << 15);
+
+	//batched cla::mul; Parallel splits large inputs across hardware threads
+	template<bool Parallel = false>
+	constexpr auto transform(std::span<const cla::vf3d> in, std::span<cla::vf3d> out, const cla::matrix<float, 4>& mat) noexcept
+	{
+		const auto count = std::min(in.size(), out.size());
+
+		if (std::is_constant_evaluated())
+		{
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				out[i] = cla::mul(in[i], mat);
+			}
+
+			return out.first(count);
+		}
+
+		if constexpr (Parallel)
+		{
+			cla::parallel_for(count, cla::transform_grain, [&](std::size_t begin, std::size_t end)
+			{
+				cla::transform_simd(in.data() + begin, out.data() + begin, end - begin, mat);
+			});
+
+			return out.first(count);
+		}
+
+		cla::transform_simd(in.data(), out.data(), count, mat);
+
+		return out.first(count);
+	}
+
+	//structure-of-arrays overloads run whole blocks of vertex_soa<T>::lanes vertices, eight floats per AVX register
+	template<typename T = float>
+	auto mul(const cla::vertex_soa<T>& in, const cla::matrix<T, 4>& mat) noexcept
+	{
+		cla::vertex_soa<T> out(in.size());
+
+		const auto& m = mat.data;
+		const auto n = in.x.size();
+
+#if defined(__AVX__)
+		if constexpr (std::is_same_v<T, float>)
+		{
+			float* const dst[4] = { out.x.data(), out.y.data(), out.z.data(), out.w.data() };
+
+			for (std::size_t i = 0; i < n; i += 8)
+			{
+				const __m256 x = _mm256_load_ps(&in.x[i]), y = _mm256_load_ps(&in.y[i]), z = _mm256_load_ps(&in.z[i]);
+
+				for (auto j = 0; j < 4; ++j)
+				{
+					__m256 r = _mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(m[0][j])), _mm256_set1_ps(m[3][j]));
+					r = _mm256_add_ps(_mm256_mul_ps(y, _mm256_set1_ps(m[1][j])), r);
+					r = _mm256_add_ps(_mm256_mul_ps(z, _mm256_set1_ps(m[2][j])), r);
+
+					_mm256_store_ps(dst[j] + i, r);
+				}
+			}
+
+			return out;
+		}
+#endif
+
+		for (std::size_t b = 0; b < n; b += cla::vertex_soa<T>::lanes)
+		{
+			for (std::size_t i = b; i < b + cla::vertex_soa<T>::lanes; ++i)
+			{
+				out.x[i] = in.x[i] * m[0][0] + in.y[i] * m[1][0] + in.z[i] * m[2][0] + m[3][0];
+				out.y[i] = in.x[i] * m[0][1] + in.y[i] * m[1][1] + in.z[i] * m[2][1] + m[3][1];
+				out.z[i] = in.x[i] * m[0][2] + in.y[i] * m[1][2] + in.z[i] * m[2][2] + m[3][2];
+				out.w[i] = in.x[i] * m[0][3] + in.y[i] * m[1][3] + in.z[i] * m[2][3] + m[3][3];
+			}
+		}
+
+		return out;
+	}
+
+	template<bool Normalize = false, typename T = float>
+	auto dot(const cla::vertex_soa<T>& vec1, const cla::vertex_soa<T>& vec2) noexcept
+	{
+		cla::aligned_vector<T> out(vec1.x.size());
+
+		const auto n = std::min(vec1.x.size(), vec2.x.size());
+
+		for (std::size_t b = 0; b < n; b += cla::vertex_soa<T>::lanes)
+		{
+			for (std::size_t i = b; i < b + cla::vertex_soa<T>::lanes; ++i)
+			{
+				out[i] = vec1.x[i] * vec2.x[i] + vec1.y[i] * vec2.y[i] + vec1.z[i] * vec2.z[i];
+
+				if constexpr (Normalize)
+				{
+					const auto len2 = (vec1.x[i] * vec1.x[i] + vec1.y[i] * vec1.y[i] + vec1.z[i] * vec1.z[i]) * (vec2.x[i] * vec2.x[i] + vec2.y[i] * vec2.y[i] + vec2.z[i] * vec2.z[i]);
+					out[i] /= std::sqrt(len2);
+				}
+			}
+		}
+
+		out.resize(std::min(vec1.size(), vec2.size()));
+
+		return out;
+	}
+
+	template<typename T = float>
+	auto normalize(const cla::vertex_soa<T>& vec) noexcept
+	{
+		cla::vertex_soa<T> out(vec.size());
+
+		const auto n = vec.x.size();
+
+		if constexpr (std::is_same_v<T, float>)
+		{
+			cla::simd_table().normalize(vec.x.data(), vec.y.data(), vec.z.data(), out.x.data(), out.y.data(), out.z.data(), n);
+		}
+		else
+		for (std::size_t b = 0; b < n; b += cla::vertex_soa<T>::lanes)
+		{
+			for (std::size_t i = b; i < b + cla::vertex_soa<T>::lanes; ++i)
+			{
+				const auto len = std::sqrt(vec.x[i] * vec.x[i] + vec.y[i] * vec.y[i] + vec.z[i] * vec.z[i]);
+
+				out.x[i] = vec.x[i] / len;
+				out.y[i] = vec.y[i] / len;
+				out.z[i] = vec.z[i] / len;
+			}
+		}
+
+		//zero-length padding lanes divided to nan; keep them zeroed
+		for (auto i = vec.size(); i < n; ++i)
+		{
+			out.x[i] = out.y[i] = out.z[i] = (T)0.0f;
+		}
+
+		return out;
+	}
+
+	template<typename T = float>
+	auto cross(const cla::vertex_soa<T>& vec1, const cla::vertex_soa<T>& vec2) noexcept
 	{
-		auto planeN = cla::normalize(plane_n);
-		T plane_d = -cla::dot(planeN, plane_p);
+		cla::vertex_soa<T> out(std::min(vec1.size(), vec2.size()));
 
-		T ad = cla::dot(lineStart, planeN);
-		T bd = cla::dot(lineEnd, planeN);
+		const auto n = out.x.size();
+
+		for (std::size_t b = 0; b < n; b += cla::vertex_soa<T>::lanes)
+		{
+			for (std::size_t i = b; i < b + cla::vertex_soa<T>::lanes; ++i)
+			{
+				out.x[i] = ((vec1.y[i] * vec2.z[i]) - (vec1.z[i] * vec2.y[i]));
+				out.y[i] = ((vec1.z[i] * vec2.x[i]) - (vec1.x[i] * vec2.z[i]));
+				out.z[i] = ((vec1.x[i] * vec2.y[i]) - (vec1.y[i] * vec2.x[i]));
+				out.w[i] = vec1.w[i];
+			}
+		}
 
-		T t = (-plane_d - ad) / (bd - ad);
+		return out;
+	}
 
-		cla::v3d_generic<T> lineStartToEnd = cla::reduce<std::minus<>>(lineEnd, lineStart);
-		cla::v3d_generic<T> lineToIntersect = cla::apply<std::multiplies<>>(lineStartToEnd, t);
+	//plane through point with the given normal, stored as unit normal n and offset d = n . point, so distance(p) = n . p - d;
+	//build it once per frame and pass it to clip and intersect instead of the point/normal pair
+	template<typename T = float>
+	struct plane
+	{
+		cla::v3d_generic<T> n;
+		T d = (T)0.0f;
 
-		return cla::reduce<std::plus<>>(lineStart, lineToIntersect);
+		constexpr plane() = default;
+		constexpr plane(const cla::v3d_generic<T>& point, const cla::v3d_generic<T>& normal) noexcept : n(cla::normalize(normal)), d(cla::dot(n, point)) {}
+	};
+
+	template<typename T = float>
+	constexpr auto distance(const cla::plane<T>& pl, const cla::v3d_generic<T>& p) noexcept
+	{
+		return (pl.n.x * p.x + pl.n.y * p.y + pl.n.z * p.z - pl.d);
+	}
+
+	//point where the segment crosses the plane
+	template<typename T = float>
+	constexpr auto intersect(const cla::plane<T>& pl, const cla::v3d_generic<T>& lineStart, const cla::v3d_generic<T>& lineEnd) noexcept
+	{
+		const T ad = cla::distance(pl, lineStart);
+		const T bd = cla::distance(pl, lineEnd);
+
+		const T t = ad / (ad - bd);
+
+		return cla::reduce<std::plus<>>(lineStart, cla::apply<std::multiplies<>>(cla::reduce<std::minus<>>(lineEnd, lineStart), t));
+	}
+
+	template<typename T = float>
+	constexpr auto intersect(const cla::v3d_generic<T>& plane_p, const cla::v3d_generic<T>& plane_n, const cla::v3d_generic<T>& lineStart, const cla::v3d_generic<T>& lineEnd) noexcept
+	{
+		return cla::intersect(cla::plane<T>(plane_p, plane_n), lineStart, lineEnd);
 	}
 
 	template<typename T = float>
@@ -198,32 +542,35 @@ export namespace cla
 		return cla::mul(vec, mat);
 	}
 
+	template<typename T = float>
+	constexpr auto operator*(const cla::v3d_generic<T>& vec, const cla::affine3x4<T>& aff) noexcept
+	{
+		return cla::mul(vec, aff);
+	}
+
 
+	//splits in_tri against pl into zero, one or two triangles that keep its winding; returns how many were written.
+	//each vertex's distance is computed once and reused for the edge intersections, so no square roots are taken
 	template<typename T = float>
-	constexpr auto clip(cla::v3d_generic<T>&& plane_p, cla::v3d_generic<T>&& plane_n, cla::tri<T>& in_tri, cla::tri<T>& out_tri1, cla::tri<T>& out_tri2) noexcept
+	constexpr auto clip(const cla::plane<T>& pl, cla::tri<T>& in_tri, cla::tri<T>& out_tri1, cla::tri<T>& out_tri2) noexcept
 	{
-		plane_n = cla::normalize(plane_n);
+		cla::v3d_generic<T>* inside_points[3];  T inside_dist[3];  int nInsidePointCount = 0;
+		cla::v3d_generic<T>* outside_points[3]; T outside_dist[3]; int nOutsidePointCount = 0;
 
-		auto dist = [&](const cla::vf3d& p)
+		for (auto p : { &in_tri.p1, &in_tri.p2, &in_tri.p3 })
 		{
-			cla::vf3d n = cla::normalize(p);
-			return (plane_n.x * p.x + plane_n.y * p.y + plane_n.z * p.z - cla::dot(plane_n, plane_p));
-		};
-
-		cla::vf3d* inside_points[3];  int nInsidePointCount = 0;
-		cla::vf3d* outside_points[3]; int nOutsidePointCount = 0;
+			const T d = cla::distance(pl, *p);
 
-		float d0 = dist(in_tri.p1);
-		float d1 = dist(in_tri.p2);
-		float d2 = dist(in_tri.p3);
+			if (d >= 0) { inside_dist[nInsidePointCount] = d; inside_points[nInsidePointCount++] = p; }
+			else { outside_dist[nOutsidePointCount] = d; outside_points[nOutsidePointCount++] = p; }
+		}
 
-		if (d0 >= 0) { inside_points[nInsidePointCount++] = &in_tri.p1; }
-		else { outside_points[nOutsidePointCount++] = &in_tri.p1; }
-		if (d1 >= 0) { inside_points[nInsidePointCount++] = &in_tri.p2; }
-		else { outside_points[nOutsidePointCount++] = &in_tri.p2; }
-		if (d2 >= 0) { inside_points[nInsidePointCount++] = &in_tri.p3; }
-		else { outside_points[nOutsidePointCount++] = &in_tri.p3; }
+		const auto cut = [&](int i, int o)
+		{
+			const T t = inside_dist[i] / (inside_dist[i] - outside_dist[o]);
 
+			return cla::reduce<std::plus<>>(*inside_points[i], cla::apply<std::multiplies<>>(cla::reduce<std::minus<>>(*outside_points[o], *inside_points[i]), t));
+		};
 
 		if (nInsidePointCount == 3)
 		{
@@ -235,8 +582,8 @@ export namespace cla
 		else if (nInsidePointCount == 1 && nOutsidePointCount == 2)
 		{
 			out_tri1.p1 = *inside_points[0];
-			out_tri1.p2 = intersect(plane_p, plane_n, *inside_points[0], *outside_points[0]);
-			out_tri1.p3 = intersect(plane_p, plane_n, *inside_points[0], *outside_points[1]);
+			out_tri1.p2 = cut(0, 0);
+			out_tri1.p3 = cut(0, 1);
 
 			return 1;
 		}
@@ -245,15 +592,219 @@ export namespace cla
 		{
 			out_tri1.p1 = *inside_points[0];
 			out_tri1.p2 = *inside_points[1];
-			out_tri1.p3 = intersect(plane_p, plane_n, *inside_points[0], *outside_points[0]);
+			out_tri1.p3 = cut(0, 0);
 
 			out_tri2.p1 = *inside_points[1];
 			out_tri2.p2 = out_tri1.p3;
-			out_tri2.p3 = intersect(plane_p, plane_n, *inside_points[1], *outside_points[0]);
+			out_tri2.p3 = cut(1, 0);
 
 			return 2;
 		}
 
 		else return 0;
 	}
+
+	template<typename T = float>
+	constexpr auto clip(cla::v3d_generic<T>&& plane_p, cla::v3d_generic<T>&& plane_n, cla::tri<T>& in_tri, cla::tri<T>& out_tri1, cla::tri<T>& out_tri2) noexcept
+	{
+		return cla::clip(cla::plane<T>(plane_p, plane_n), in_tri, out_tri1, out_tri2);
+	}
+
+	//a convex polygon gains at most one vertex per plane, so clip_batch keeps its working polygons on the stack up to this many planes
+	constexpr auto clip_max_planes = static_cast<std::size_t>(16);
+
+	//clips every triangle of in against all planes (Sutherland-Hodgman) and fans each surviving polygon back into triangles that keep the
+	//source winding, lightVal and texture; out.size() >= in.size() * (planes.size() + 1) always suffices, otherwise writing stops before
+	//the first triangle whose pieces no longer fit. returns the written part of out, or nothing if there are more than clip_max_planes planes
+	template<typename T = float>
+	auto clip_batch(std::span<const cla::tri<std::type_identity_t<T>>> in, std::span<const cla::plane<std::type_identity_t<T>>> planes, std::span<cla::tri<std::type_identity_t<T>>> out) noexcept
+	{
+		constexpr auto maxVerts = cla::clip_max_planes + 3;
+
+		std::size_t count = 0;
+
+		if (planes.size() > cla::clip_max_planes) return out.first(0);
+
+		for (const auto& t : in)
+		{
+			cla::v3d_generic<T> polyA[maxVerts], polyB[maxVerts];
+			T dist[maxVerts];
+
+			auto* src = polyA;
+			auto* dst = polyB;
+
+			src[0] = t.p1; src[1] = t.p2; src[2] = t.p3;
+			std::size_t n = 3;
+
+			for (const auto& pl : planes)
+			{
+				std::size_t inside = 0;
+
+				for (std::size_t i = 0; i < n; ++i) inside += ((dist[i] = cla::distance(pl, src[i])) >= 0);
+
+				if (inside == n) continue;
+
+				std::size_t m = 0;
+
+				if (inside > 0)
+				{
+					for (std::size_t i = 0; i < n; ++i)
+					{
+						const auto j = (i + 1 == n) ? 0 : i + 1;
+
+						if (dist[i] >= 0) dst[m++] = src[i];
+
+						if ((dist[i] >= 0) != (dist[j] >= 0))
+						{
+							const T s = dist[i] / (dist[i] - dist[j]);
+
+							dst[m++] = cla::reduce<std::plus<>>(src[i], cla::apply<std::multiplies<>>(cla::reduce<std::minus<>>(src[j], src[i]), s));
+						}
+					}
+				}
+
+				std::swap(src, dst);
+				n = m;
+
+				if (n < 3) break;
+			}
+
+			if (n < 3) continue;
+
+			if (count + (n - 2) > out.size()) break;
+
+			for (std::size_t i = 1; i + 1 < n; ++i)
+			{
+				out[count++] = cla::tri<T>(src[0], src[i], src[i + 1], t.lightVal, t.texture);
+			}
+		}
+
+		return out.first(count);
+	}
+
+	//same, with the output carved out of scratch; the result lives until scratch.reset()
+	template<typename T = float>
+	auto clip_batch(std::span<const cla::tri<std::type_identity_t<T>>> in, std::span<const cla::plane<std::type_identity_t<T>>> planes, cla::arena& scratch)
+	{
+		const auto capacity = in.size() * (planes.size() + 1);
+
+		auto* buffer = static_cast<cla::tri<T>*>(scratch.allocate(capacity * sizeof(cla::tri<T>), alignof(cla::tri<T>)));
+
+		std::uninitialized_default_construct_n(buffer, capacity);
+
+		return cla::clip_batch<T>(in, planes, std::span<cla::tri<T>>(buffer, capacity));
+	}
+
+	//clip-space planes for cla::clip_homogeneous, as bits of a vertex outcode
+	enum clip_bits : unsigned { clip_near = 1, clip_left = 2, clip_right = 4, clip_bottom = 8, clip_top = 16 };
+
+	//signed distance of a clip-space vertex (w kept) to plane bit of the guard band |x|, |y| <= guardBand * w, z >= 0
+	template<typename T = float>
+	constexpr auto clip_distance(unsigned bit, const cla::v3d_generic<T>& p, const T& guardBand) noexcept
+	{
+		switch (bit)
+		{
+			case cla::clip_near: return p.z;
+			case cla::clip_left: return guardBand * p.w + p.x;
+			case cla::clip_right: return guardBand * p.w - p.x;
+			case cla::clip_bottom: return guardBand * p.w + p.y;
+			default: return guardBand * p.w - p.y;
+		}
+	}
+
+	template<typename T = float>
+	constexpr auto outcode(const cla::v3d_generic<T>& p, const T& guardBand) noexcept
+	{
+		unsigned code = 0;
+
+		for (unsigned bit = cla::clip_near; bit <= cla::clip_top; bit <<= 1) code |= (cla::clip_distance(bit, p, guardBand) < 0) ? bit : 0u;
+
+		return code;
+	}
+
+	//clips projected triangles (v * projection, before the divide, so w is still view depth) against the near plane and the guard band
+	//|x|, |y| <= guardBand * w; guardBand is in viewport half-extents, so 1 clips exactly at the screen edges and larger values leave
+	//triangles that only overhang the viewport to the rasterizer's scissor. triangles inside everything are copied through, triangles
+	//wholly outside one plane are dropped, and only the planes a triangle actually crosses are clipped against. the far plane is not
+	//clipped. out.size() >= in.size() * 6 always suffices, otherwise writing stops before the first triangle that no longer fits.
+	//returns the written part of out; lightVal and texture are carried over
+	template<typename T = float>
+	auto clip_homogeneous(std::span<const cla::tri<std::type_identity_t<T>>> in, std::span<cla::tri<std::type_identity_t<T>>> out, const std::type_identity_t<T>& guardBand = (T)1.0f) noexcept
+	{
+		constexpr auto maxVerts = static_cast<std::size_t>(8);
+
+		std::size_t count = 0;
+
+		//component-wise, w included; the v3d_generic copy constructor would reset w
+		const auto lerp = [](const cla::v3d_generic<T>& a, const cla::v3d_generic<T>& b, const T& s)
+		{
+			cla::v3d_generic<T> outVec(a.x + (b.x - a.x) * s, a.y + (b.y - a.y) * s, a.z + (b.z - a.z) * s);
+			outVec.w = a.w + (b.w - a.w) * s;
+
+			return outVec;
+		};
+
+		for (const auto& t : in)
+		{
+			const auto c1 = cla::outcode(t.p1, guardBand), c2 = cla::outcode(t.p2, guardBand), c3 = cla::outcode(t.p3, guardBand);
+
+			if (c1 & c2 & c3) continue;
+
+			if (count + 1 > out.size()) break;
+
+			if ((c1 | c2 | c3) == 0)
+			{
+				out[count++] = t;
+
+				continue;
+			}
+
+			cla::v3d_generic<T> polyA[maxVerts], polyB[maxVerts];
+			T dist[maxVerts];
+
+			auto* src = polyA;
+			auto* dst = polyB;
+
+			src[0] = t.p1; src[1] = t.p2; src[2] = t.p3;
+			std::size_t n = 3;
+
+			const auto crossed = c1 | c2 | c3;
+
+			for (unsigned bit = cla::clip_near; bit <= cla::clip_top && n >= 3; bit <<= 1)
+			{
+				if (!(crossed & bit)) continue;
+
+				for (std::size_t i = 0; i < n; ++i) dist[i] = cla::clip_distance(bit, src[i], guardBand);
+
+				std::size_t m = 0;
+
+				for (std::size_t i = 0; i < n; ++i)
+				{
+					const auto j = (i + 1 == n) ? 0 : i + 1;
+
+					if (dist[i] >= 0) dst[m++] = src[i];
+
+					if ((dist[i] >= 0) != (dist[j] >= 0)) dst[m++] = lerp(src[i], src[j], dist[i] / (dist[i] - dist[j]));
+				}
+
+				std::swap(src, dst);
+				n = m;
+			}
+
+			if (n < 3) continue;
+
+			if (count + (n - 2) > out.size()) break;
+
+			for (std::size_t i = 1; i + 1 < n; ++i)
+			{
+				auto& o = out[count++];
+
+				o.p1 = src[0]; o.p2 = src[i]; o.p3 = src[i + 1];
+				o.lightVal = t.lightVal;
+				o.texture = t.texture;
+			}
+		}
+
+		return out.first(count);
+	}
 }
\ No newline at end of file